@@ -0,0 +1,195 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_AFFINITY_H_
+#define CAMILLE_INCLUDE_CAMILLE_AFFINITY_H_
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief Thread placement for the io_context threads.
+ * @details The CPU topology is read from /sys (Linux), threads are spread over the physical cores
+ * of a NUMA node before the SMT siblings and before the next node. There is no libnuma, per-thread
+ * state is made node-local by first touch: the pinned thread allocates it after pinning.
+ */
+
+namespace camille {
+namespace affinity {
+
+static constexpr std::string_view kSysCpu = "/sys/devices/system/cpu";
+
+struct Cpu {
+  int id{0};
+  int core{0};
+  int package{0};
+  int node{0};
+};
+
+struct Options {
+  bool pin{false};
+  /**
+   * @brief CPUs handed out to the threads in order (wrapping), empty means the topology order.
+   */
+  std::vector<int> cpus;
+};
+
+/**
+ * @brief Parses a kernel style CPU list, e.g. "0-3,8,10-11".
+ * @throws std::invalid_argument on a malformed list
+ */
+inline std::vector<int> ParseCpuList(std::string_view list) {
+  std::vector<int> cpus;
+  auto parse_number = [list](std::string_view text) {
+    int value{0};
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{} || end != text.data() + text.size() || value < 0) {
+      throw std::invalid_argument("Bad CPU list: " + std::string(list));
+    }
+    return value;
+  };
+  while (!list.empty()) {
+    auto comma = list.find(',');
+    auto item = list.substr(0, comma);
+    list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+    if (item.empty()) {
+      continue;
+    }
+    auto dash = item.find('-');
+    if (dash == std::string_view::npos) {
+      cpus.push_back(parse_number(item));
+      continue;
+    }
+    int first = parse_number(item.substr(0, dash));
+    int last = parse_number(item.substr(dash + 1));
+    if (last < first) {
+      throw std::invalid_argument("Bad CPU list: " + std::string(item));
+    }
+    for (int cpu{first}; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+/**
+ * @brief CPUs the process may run on (empty off Linux).
+ */
+inline std::vector<int> AllowedCpus() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu{0}; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return cpus;
+}
+
+/**
+ * @brief Topology of the allowed CPUs, missing /sys entries read as core = id, package and node 0.
+ */
+inline std::vector<Cpu> ReadTopology(const std::filesystem::path& root = kSysCpu) {
+  auto read_int = [](const std::filesystem::path& path, int fallback) {
+    std::ifstream file(path);
+    int value{fallback};
+    if (file && (file >> value)) {
+      return value;
+    }
+    return fallback;
+  };
+  std::vector<Cpu> topology;
+  for (int id : AllowedCpus()) {
+    auto directory = root / ("cpu" + std::to_string(id));
+    Cpu cpu{id, read_int(directory / "topology" / "core_id", id),
+            read_int(directory / "topology" / "physical_package_id", 0), 0};
+    std::error_code error_code;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error_code)) {
+      auto name = entry.path().filename().string();
+      if (name.starts_with("node")) {
+        std::from_chars(name.data() + 4, name.data() + name.size(), cpu.node);
+        break;
+      }
+    }
+    topology.push_back(cpu);
+  }
+  return topology;
+}
+
+/**
+ * @brief Physical cores first (first sibling of each core), node by node, then the SMT siblings.
+ */
+inline std::vector<int> SpreadOrder(std::vector<Cpu> topology) {
+  std::ranges::sort(topology, {}, &Cpu::id);
+  std::map<std::pair<int, int>, int> siblings;
+  std::vector<std::tuple<int, int, int, int, int>> keyed;
+  keyed.reserve(topology.size());
+  for (const auto& cpu : topology) {
+    int rank = siblings[{cpu.package, cpu.core}]++;
+    keyed.emplace_back(rank, cpu.node, cpu.package, cpu.core, cpu.id);
+  }
+  std::ranges::sort(keyed);
+  std::vector<int> order;
+  order.reserve(keyed.size());
+  for (const auto& key : keyed) {
+    order.push_back(std::get<4>(key));
+  }
+  return order;
+}
+
+/**
+ * @brief CPU of every thread, -1 when the thread is left to the scheduler.
+ */
+inline std::vector<int> Plan(const Options& options, std::size_t threads) {
+  std::vector<int> plan(threads, -1);
+  if (!options.pin) {
+    return plan;
+  }
+  auto cpus = options.cpus.empty() ? SpreadOrder(ReadTopology()) : options.cpus;
+  if (cpus.empty()) {
+    return plan;
+  }
+  for (std::size_t index{0}; index < threads; ++index) {
+    plan[index] = cpus[index % cpus.size()];
+  }
+  return plan;
+}
+
+/**
+ * @return false when the CPU is not available or pinning is not supported
+ */
+inline bool PinCurrentThread(int cpu) {
+#ifdef __linux__
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+};  // namespace affinity
+};  // namespace camille
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_BACKEND_H_
+#define CAMILLE_INCLUDE_CAMILLE_BACKEND_H_
+
+#include "asio/detail/config.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define CAMILLE_IO_URING_PROBE 1
+#endif
+
+/**
+ * @brief The I/O backend asio was compiled with for the io_contexts.
+ * @details Building with -DCAMILLE_IO_URING=ON (liburing required) sets ASIO_HAS_IO_URING and
+ * ASIO_DISABLE_EPOLL, socket and file operations of every io_context then go through an io_uring
+ * instead of the epoll reactor. The reactor is chosen at compile time, so the option is an opt-in
+ * with no fallback: CMake stops when liburing is missing and pool::ContextPool throws when
+ * IoUringSupported() reports a kernel without io_uring.
+ */
+
+namespace camille {
+namespace backend {
+
+enum class Kind : std::uint8_t { kEpoll, kIoUring, kOther };
+
+#if defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+static constexpr Kind kCompiled = Kind::kIoUring;
+#elif defined(ASIO_HAS_EPOLL)
+static constexpr Kind kCompiled = Kind::kEpoll;
+#else
+static constexpr Kind kCompiled = Kind::kOther;
+#endif
+
+static constexpr std::string_view KindToString(const Kind kind) {
+  switch (kind) {
+    case Kind::kEpoll:
+      return "epoll";
+    case Kind::kIoUring:
+      return "io_uring";
+    default:
+      return "other";
+  }
+}
+
+/**
+ * @brief Probes the running kernel with a one entry ring (io_uring can be missing, too old or
+ * disabled by seccomp or kernel.io_uring_disabled).
+ */
+inline bool IoUringSupported() {
+#ifdef CAMILLE_IO_URING_PROBE
+  io_uring_params params{};
+  auto fd = static_cast<int>(syscall(__NR_io_uring_setup, 1, &params));
+  if (fd < 0) {
+    return false;
+  }
+  close(fd);
+  return true;
+#else
+  return false;
+#endif
+}
+
+};  // namespace backend
+};  // namespace camille
+
+#endif
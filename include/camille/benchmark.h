@@ -1,29 +1,242 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_BENCHMARK_H_
 #define CAMILLE_INCLUDE_CAMILLE_BENCHMARK_H_
 
+#include "logging.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
-#include <print>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Latency instrumentation, cheap enough to stay on in production.
+ * @details Every thread records into its own log-linear (HDR style) histograms, one per phase, with
+ * plain relaxed loads and stores (each histogram has a single writer). Collect() merges the threads
+ * on demand into percentiles, readers never block the io threads.
+ */
 
 namespace camille {
+namespace benchmark {
 
-class Benchmark {
+using Clock = std::chrono::steady_clock;
+
+enum class Phase : std::uint8_t { kParse, kRoute, kHandler, kWrite };
+static constexpr std::size_t kPhaseCount = 4;
+
+static constexpr std::string_view PhaseToString(const Phase phase) {
+  switch (phase) {
+    case Phase::kParse:
+      return "parse";
+    case Phase::kRoute:
+      return "route";
+    case Phase::kHandler:
+      return "handler";
+    case Phase::kWrite:
+      return "write";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * @brief 2^kSubBucketBits linear sub buckets per power of two (~3% relative error), values (ns)
+ * above 2^kMaxBits (~73 minutes) land in the last bucket.
+ */
+static constexpr std::size_t kSubBucketBits = 5;
+static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+static constexpr std::size_t kMaxBits = 42;
+static constexpr std::size_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+static constexpr std::size_t BucketIndex(std::uint64_t value) {
+  if (value < kSubBuckets) {
+    return static_cast<std::size_t>(value);
+  }
+  auto msb = static_cast<std::size_t>(std::bit_width(value) - 1);
+  if (msb >= kMaxBits) {
+    return kBuckets - 1;
+  }
+  auto sub = static_cast<std::size_t>(value >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+  return (msb - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+/**
+ * @brief Lowest value that falls in the bucket at index.
+ */
+static constexpr std::uint64_t BucketValue(std::size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  std::size_t bucket = index / kSubBuckets;
+  std::uint64_t sub = index % kSubBuckets;
+  return (kSubBuckets + sub) << (bucket - 1);
+}
+
+class Histogram {
  public:
-  explicit Benchmark(std::string benchmark_name)
-      : benchmark_name_(std::move(benchmark_name)),
-        start_(std::chrono::high_resolution_clock::now()) {}
-  ~Benchmark() {
-    auto end = std::chrono::high_resolution_clock::now();
-    auto elapsed_milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - start_);
-    auto elapsed_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start_);
+  /**
+   * @brief Owning thread only, relaxed load and store instead of a locked read-modify-write.
+   */
+  void Record(std::uint64_t nanoseconds) {
+    auto& bucket = buckets_[BucketIndex(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > max_.load(std::memory_order_relaxed)) {
+      max_.store(nanoseconds, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  friend class Recorder;
+
+  std::array<std::atomic<std::uint64_t>, kBuckets> buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
 
-    std::println("{}: {}, {}", benchmark_name_, elapsed_milliseconds, elapsed_microseconds);
+/**
+ * @brief Merged view of one phase, durations in nanoseconds (percentiles at bucket resolution).
+ */
+struct Summary {
+  std::uint64_t count{0};
+  std::uint64_t sum{0};
+  std::uint64_t mean{0};
+  std::uint64_t max{0};
+  std::uint64_t p50{0};
+  std::uint64_t p99{0};
+  std::uint64_t p999{0};
+};
+
+/**
+ * @brief Sum of the histograms of one phase across every thread.
+ */
+struct Merged {
+  std::array<std::uint64_t, kBuckets> buckets{};
+  std::uint64_t count{0};
+  std::uint64_t sum{0};
+  std::uint64_t max{0};
+};
+
+/**
+ * @brief The histograms of every thread that ever recorded, shared so they outlive their thread.
+ */
+class Recorder {
+ public:
+  static Recorder& Instance() {
+    static Recorder recorder;
+    return recorder;
   }
 
+  std::array<Histogram, kPhaseCount>& ThreadHistograms() {
+    thread_local std::shared_ptr<std::array<Histogram, kPhaseCount>> histograms = [this]() {
+      auto created = std::make_shared<std::array<Histogram, kPhaseCount>>();
+      std::lock_guard lock(mutex_);
+      threads_.push_back(created);
+      return created;
+    }();
+    return *histograms;
+  }
+
+  [[nodiscard]] Merged Merge(Phase phase) {
+    Merged merged;
+    std::lock_guard lock(mutex_);
+    for (const auto& thread : threads_) {
+      const auto& histogram = (*thread)[static_cast<std::size_t>(phase)];
+      for (std::size_t index{0}; index < kBuckets; ++index) {
+        merged.buckets[index] += histogram.buckets_[index].load(std::memory_order_relaxed);
+      }
+      merged.count += histogram.count_.load(std::memory_order_relaxed);
+      merged.sum += histogram.sum_.load(std::memory_order_relaxed);
+      auto max = histogram.max_.load(std::memory_order_relaxed);
+      merged.max = max > merged.max ? max : merged.max;
+    }
+    return merged;
+  }
+
+  [[nodiscard]] Summary Collect(Phase phase) {
+    auto merged = Merge(phase);
+    Summary summary{.count = merged.count, .sum = merged.sum, .max = merged.max};
+    if (summary.count == 0) {
+      return summary;
+    }
+    summary.mean = summary.sum / summary.count;
+    summary.p50 = Percentile(merged.buckets, summary.count, 0.5);
+    summary.p99 = Percentile(merged.buckets, summary.count, 0.99);
+    summary.p999 = Percentile(merged.buckets, summary.count, 0.999);
+    return summary;
+  }
+
+ private:
+  Recorder() = default;
+
+  static std::uint64_t Percentile(const std::array<std::uint64_t, kBuckets>& merged,
+                                  std::uint64_t count,
+                                  double quantile) {
+    auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(count));
+    std::uint64_t seen{0};
+    for (std::size_t index{0}; index < kBuckets; ++index) {
+      seen += merged[index];
+      if (seen > rank) {
+        return BucketValue(index);
+      }
+    }
+    return BucketValue(kBuckets - 1);
+  }
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<std::array<Histogram, kPhaseCount>>> threads_;
+};
+
+inline void Record(Phase phase, Clock::duration elapsed) {
+  auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  Recorder::Instance().ThreadHistograms()[static_cast<std::size_t>(phase)].Record(
+      static_cast<std::uint64_t>(nanoseconds < 0 ? 0 : nanoseconds));
+}
+
+inline Summary Collect(Phase phase) { return Recorder::Instance().Collect(phase); }
+
+inline Merged Merge(Phase phase) { return Recorder::Instance().Merge(phase); }
+
+/**
+ * @brief Logs count, mean and tail of every phase.
+ */
+inline void Report() {
+  for (std::size_t index{0}; index < kPhaseCount; ++index) {
+    auto phase = static_cast<Phase>(index);
+    auto summary = Collect(phase);
+    CAMILLE_INFO("{}: count {} mean {}ns p50 {}ns p99 {}ns p999 {}ns max {}ns",
+                 PhaseToString(phase), summary.count, summary.mean, summary.p50, summary.p99,
+                 summary.p999, summary.max);
+  }
+}
+
+};  // namespace benchmark
+
+/**
+ * @brief Records the lifetime of the scope into the phase histogram of the calling thread.
+ */
+class Benchmark {
+ public:
+  explicit Benchmark(benchmark::Phase phase)
+      : phase_(phase),
+        start_(benchmark::Clock::now()) {}
+  ~Benchmark() { benchmark::Record(phase_, benchmark::Clock::now() - start_); }
+
+  Benchmark(const Benchmark&) = delete;
+  Benchmark& operator=(const Benchmark&) = delete;
+
  private:
-  std::string benchmark_name_;
-  std::chrono::high_resolution_clock::time_point start_;
+  benchmark::Phase phase_;
+  benchmark::Clock::time_point start_;
 };
 
 };  // namespace camille
 
-#endif
\ No newline at end of file
+#endif
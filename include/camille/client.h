@@ -1,6 +1,7 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_CLIENT_H_
 #define CAMILLE_INCLUDE_CAMILLE_CLIENT_H_
 
+#include "metrics.h"
 #include "middleware.h"
 #include "router.h"
 #include "server.h"
@@ -34,26 +35,74 @@ class Camille : public client::BaseClient {
     host_ = host;
     port_ = port;
     if (!server_) {
-      server_ = std::make_unique<server::Server>(host_, port_, pool_size_);
+      server_ = std::make_unique<server::Server>(host_, port_, route_table_, pool_size_,
+                                                 reuse_port_);
+      server_->SetTimeouts(timeouts_);
+      server_->SetAffinity(affinity_);
+      server_->SetTaskPoolSize(task_pool_size_);
+      server_->SetState(debug_);
     }
     server_->Run([this]() { CAMILLE("Listening at: http://{}:{}", host_, port_); });
   }
 
   [[nodiscard]] bool IsDebugEnabled() const { return debug_; }
 
+  /**
+   * @brief Debug sessions log every request, the log level is lowered to kDebug (if it is not
+   * already) to show them.
+   */
   void SetDebug(bool debug) {
     debug_ = debug;
-    server_->SetState(debug_);
+    logger::SetLevel(debug_ ? std::min(logger::Level::kDebug, logger::kDefaultLevel)
+                            : logger::kDefaultLevel);
+    if (server_) {
+      server_->SetState(debug_);
+    }
   };
   void SetServerName(const std::string& server_name) { server_name_ = server_name; }
   void SetServerVersion(const std::string& server_version) { server_version_ = server_version; }
   void SetPoolSize(unsigned pool_size) { pool_size_ = pool_size; }
+  void SetTimeouts(const network::Timeouts& timeouts) { timeouts_ = timeouts; }
+  /**
+   * @brief One SO_REUSEPORT listener per io_context instead of a single acceptor (Linux, BSD).
+   */
+  void SetReusePort(bool reuse_port) { reuse_port_ = reuse_port; }
+  /**
+   * @brief Pins the io_context threads, e.g. {.pin = true} or {true, ParseCpuList("0-7")}.
+   */
+  void SetAffinity(const affinity::Options& options) { affinity_ = options; }
+  /**
+   * @brief Workers running the router::Execution::kOffload routes.
+   */
+  void SetTaskPoolSize(unsigned task_pool_size) { task_pool_size_ = task_pool_size; }
 
   void AddMiddleware(const middleware::BaseMiddleware& middleware) override {
     auto name = middleware.GetMiddlewareName();
     CAMILLE("Middleware Added {}", middleware.GetMiddlewareName());
   }
-  void AddRouter(const router::Router& router) override {}
+  /**
+   * @brief Routes are added to the shared route table, routers added after Run() are not served.
+   */
+  void AddRouter(const router::Router& router) override {
+    route_table_->Add(router);
+    routers_.push_back(router);
+  }
+
+  /**
+   * @brief Serves the metrics registry at path in the Prometheus text format (opt-in, call it
+   * before Run() like AddRouter()).
+   * @param path
+   */
+  void EnableMetrics(const std::string& path = "/metrics") {
+    router::Router metrics_router{path, std::nullopt};
+    metrics_router.Get("", infra::StatusCodes::kOk, [](const request::RequestView&) {
+      response::Response response;
+      response.AddHeader(infra::headers::kContentType, metrics::kContentType);
+      response.SetBody(metrics::Registry::Instance().Render());
+      return response;
+    });
+    AddRouter(metrics_router);
+  }
 
   /**
    * @brief usage in the ctor, appending and reading all
@@ -73,9 +122,15 @@ class Camille : public client::BaseClient {
   std::uint16_t port_{0};
   std::string server_name_;
   std::string server_version_;
-  std::vector<router::Router> routers_;  // add prefix tree.
+  std::vector<router::Router> routers_;
+  types::camille::CamilleShared<router::RouteTable> route_table_{
+      std::make_shared<router::RouteTable>()};
   types::camille::CamilleUnique<server::Server> server_;
   unsigned pool_size_{std::thread::hardware_concurrency()};
+  unsigned task_pool_size_{std::thread::hardware_concurrency()};
+  network::Timeouts timeouts_;
+  bool reuse_port_{false};
+  affinity::Options affinity_;
 };
 
 };  // namespace camille
@@ -1,27 +1,25 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_CONNECTION_H_
 #define CAMILLE_INCLUDE_CAMILLE_CONNECTION_H_
 
-#include <mutex>
-#include <atomic>
+#include "metrics.h"
 
 namespace camille {
 
 // Connection manager for handling multiple concurrent connections
 // (cpp-httplib style: could be extended with thread pool)
+// Backed by the camille_connections_active gauge, every session counts itself in and out on its
+// own thread, count() sums the threads.
 class ConnectionManager {
  public:
-  ConnectionManager()
-      : connection_count_(0) {}
+  ConnectionManager() = default;
 
-  void increment() { ++connection_count_; }
-  void decrement() { --connection_count_; }
-  [[nodiscard]] int count() const { return connection_count_; }
-
- private:
-  std::mutex connection_mutex_;
-  std::atomic<int> connection_count_;
+  void increment() { metrics::Builtins::Instance().connections_active.Add(); }
+  void decrement() { metrics::Builtins::Instance().connections_active.Sub(); }
+  [[nodiscard]] int count() const {
+    return static_cast<int>(metrics::Builtins::Instance().connections_active.Value());
+  }
 };
 
 }  // namespace camille
 
-#endif
\ No newline at end of file
+#endif
@@ -1,8 +1,26 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_DATA_STRUCTURES_H_
 #define CAMILLE_INCLUDE_CAMILLE_DATA_STRUCTURES_H_
 
-#include <unordered_map>
+#include "infra.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace camille {
 namespace datastructure {
@@ -12,6 +30,12 @@ class DataStructure {
   virtual ~DataStructure() = default;
 };
 
+/**
+ * @brief Least recently used cache, not thread-safe. An evicted or replaced value is destroyed, so
+ * a value that owns a resource (a file descriptor) releases it once nobody else holds it.
+ * @tparam KeyType
+ * @tparam ValueType
+ */
 template <typename KeyType, typename ValueType>
 class LruCache : public DataStructure {
  public:
@@ -29,33 +53,613 @@ class LruCache : public DataStructure {
       return std::nullopt;
     }
     items_.splice(items_.begin(), items_, it->second);
-    return it->second->first;
+    return it->second->second;
   }
 
   void put(KeyType key, ValueType value) {
     auto it = cache_.find(key);
     if (it != cache_.end()) {
-      items_.splice(items_.begin(), items_, it->second->second);
-      it->second->first = value;
+      items_.splice(items_.begin(), items_, it->second);
+      it->second->second = std::move(value);
+      return;
+    }
+    if (capacity_ == 0) {
       return;
     }
     if (items_.size() == capacity_) {
-      KeyType key_to_delete = items_.back().first;
+      cache_.erase(items_.back().first);
       items_.pop_back();
-      cache_.erase(key_to_delete);
     }
 
-    items_.emplace_front(key, value);
-    cache_[key] = items_.begin();
+    items_.emplace_front(key, std::move(value));
+    cache_.emplace(std::move(key), items_.begin());
   }
 
+  void erase(const KeyType& key) {
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+      return;
+    }
+    items_.erase(it->second);
+    cache_.erase(it);
+  }
+
+  [[nodiscard]] size_t size() const { return items_.size(); }
+
  private:
   size_t capacity_;
   Items items_;
   Cache cache_;
 };
 
-class PrefixTree : public DataStructure {};
+struct CacheStats {
+  std::uint64_t hits{0};
+  std::uint64_t misses{0};
+  std::uint64_t evictions{0};
+  std::uint64_t expirations{0};
+};
+
+/**
+ * @brief Concurrent cache for every ContextPool thread, split in shards each holding a CLOCK
+ * (second chance) over a flat slot array.
+ * @details Get() takes only the shared lock of its shard and marks the slot with a relaxed atomic
+ * reference bit, so readers never serialize on each other; Put() and Erase() take the shard lock
+ * exclusively and the clock hand evicts the first slot not referenced since its last pass. Values
+ * are copied out, cache std::shared_ptr<const T> for anything larger than a handle (rendered
+ * responses). Entries past their TTL count as misses and are reused first.
+ * @tparam KeyType
+ * @tparam ValueType
+ * @tparam Hash
+ */
+template <typename KeyType, typename ValueType, typename Hash = std::hash<KeyType>>
+class ShardedCache : public DataStructure {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param capacity - total entries, split evenly across the shards.
+   * @param shards - rounded up to a power of two.
+   * @param ttl - default time to live, zero keeps entries until evicted.
+   */
+  explicit ShardedCache(size_t capacity, size_t shards = 16, Clock::duration ttl = {})
+      : shard_count_(std::bit_ceil(shards == 0 ? size_t{1} : shards)),
+        ttl_(ttl) {
+    if (capacity < shard_count_) {
+      throw std::invalid_argument("ShardedCache capacity is smaller than its shard count");
+    }
+    shards_ = std::make_unique<Shard[]>(shard_count_);
+    for (size_t index{0}; index < shard_count_; ++index) {
+      shards_[index].Init(capacity / shard_count_ + (index < capacity % shard_count_ ? 1 : 0));
+    }
+  }
+
+  [[nodiscard]] std::optional<ValueType> Get(const KeyType& key) const {
+    auto& shard = ShardFor(key);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      shard.misses.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    const auto& slot = shard.slots[it->second];
+    if (Expired(slot, Clock::now())) {
+      shard.misses.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    slot.referenced.store(true, std::memory_order_relaxed);
+    shard.hits.fetch_add(1, std::memory_order_relaxed);
+    return slot.value;
+  }
+
+  void Put(const KeyType& key, ValueType value) { Put(key, std::move(value), ttl_); }
+
+  void Put(const KeyType& key, ValueType value, Clock::duration ttl) {
+    auto& shard = ShardFor(key);
+    auto expires = ttl == Clock::duration::zero() ? Clock::time_point::max() : Clock::now() + ttl;
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      auto& slot = shard.slots[it->second];
+      slot.value = std::move(value);
+      slot.expires = expires;
+      slot.referenced.store(true, std::memory_order_relaxed);
+      return;
+    }
+
+    size_t position = shard.used < shard.slots.size() ? shard.used++ : Evict(shard);
+    auto& slot = shard.slots[position];
+    slot.key = key;
+    slot.value = std::move(value);
+    slot.expires = expires;
+    slot.occupied = true;
+    slot.referenced.store(false, std::memory_order_relaxed);
+    shard.index.emplace(key, position);
+  }
+
+  bool Erase(const KeyType& key) {
+    auto& shard = ShardFor(key);
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      return false;
+    }
+    auto& slot = shard.slots[it->second];
+    slot.occupied = false;
+    slot.value = ValueType{};
+    shard.index.erase(it);
+    return true;
+  }
+
+  [[nodiscard]] size_t Size() const {
+    size_t size{0};
+    for (size_t index{0}; index < shard_count_; ++index) {
+      std::shared_lock lock(shards_[index].mutex);
+      size += shards_[index].index.size();
+    }
+    return size;
+  }
+
+  [[nodiscard]] CacheStats Stats() const {
+    CacheStats stats;
+    for (size_t index{0}; index < shard_count_; ++index) {
+      const auto& shard = shards_[index];
+      stats.hits += shard.hits.load(std::memory_order_relaxed);
+      stats.misses += shard.misses.load(std::memory_order_relaxed);
+      stats.evictions += shard.evictions.load(std::memory_order_relaxed);
+      stats.expirations += shard.expirations.load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+ private:
+  struct Slot {
+    KeyType key{};
+    ValueType value{};
+    Clock::time_point expires{Clock::time_point::max()};
+    bool occupied{false};
+    mutable std::atomic<bool> referenced{false};
+  };
+
+  /**
+   * @brief Aligned to its own cache lines so the locks and counters of two shards never share one.
+   */
+  struct alignas(64) Shard {
+    void Init(size_t capacity) {
+      slots = std::vector<Slot>(capacity);
+      index.reserve(capacity);
+    }
+
+    mutable std::shared_mutex mutex;
+    std::vector<Slot> slots;
+    std::unordered_map<KeyType, size_t, Hash> index;
+    size_t used{0};
+    size_t hand{0};
+    mutable std::atomic<std::uint64_t> hits{0};
+    mutable std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> evictions{0};
+    std::atomic<std::uint64_t> expirations{0};
+  };
+
+  static bool Expired(const Slot& slot, Clock::time_point now) { return slot.expires <= now; }
+
+  /**
+   * @brief Runs the clock hand to a free, expired or unreferenced slot and empties it, called with
+   * the shard lock held exclusively. Ends within two turns, the first one clears every bit.
+   */
+  size_t Evict(Shard& shard) {
+    auto now = Clock::now();
+    while (true) {
+      size_t position = shard.hand;
+      shard.hand = (shard.hand + 1) % shard.slots.size();
+      auto& slot = shard.slots[position];
+      if (!slot.occupied) {
+        return position;
+      }
+      if (Expired(slot, now)) {
+        shard.expirations.fetch_add(1, std::memory_order_relaxed);
+      } else if (slot.referenced.exchange(false, std::memory_order_relaxed)) {
+        continue;
+      } else {
+        shard.evictions.fetch_add(1, std::memory_order_relaxed);
+      }
+      shard.index.erase(slot.key);
+      slot.occupied = false;
+      return position;
+    }
+  }
+
+  Shard& ShardFor(const KeyType& key) const {
+    // high bits pick the shard, the low bits stay spread for the shard's own index.
+    auto hash = static_cast<std::uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15ULL;
+    return shards_[(hash >> 32) & (shard_count_ - 1)];
+  }
+
+  size_t shard_count_;
+  Clock::duration ttl_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+/**
+ * @brief Chase-Lev work-stealing deque: the owner pushes and pops at the bottom, any thread steals
+ * from the top, a single CAS settles the race for the last item.
+ * @details The ring grows by doubling (owner only), retired rings stay alive until the deque is
+ * destroyed since a thief may still read from one.
+ * @tparam ValueType - trivially copyable (a pointer to the task)
+ */
+template <typename ValueType>
+class WorkStealingDeque : public DataStructure {
+ public:
+  explicit WorkStealingDeque(std::size_t capacity = 256) {
+    rings_.push_back(std::make_unique<Ring>(std::bit_ceil(capacity < 2 ? 2 : capacity)));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  /**
+   * @brief Owner only.
+   */
+  void Push(ValueType value) {
+    auto bottom = bottom_.load(std::memory_order_relaxed);
+    auto top = top_.load(std::memory_order_acquire);
+    auto* ring = ring_.load(std::memory_order_relaxed);
+    if (bottom - top >= ring->Capacity()) {
+      ring = Grow(ring, top, bottom);
+    }
+    ring->Store(bottom, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Owner only, newest first.
+   */
+  std::optional<ValueType> Pop() {
+    auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    auto* ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    auto value = ring->Load(bottom);
+    if (top == bottom) {
+      bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      if (!won) {
+        return std::nullopt;
+      }
+    }
+    return value;
+  }
+
+  /**
+   * @brief Any thread, oldest first, empty on a lost race as well.
+   */
+  std::optional<ValueType> Steal() {
+    auto top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return std::nullopt;
+    }
+    auto value = ring_.load(std::memory_order_acquire)->Load(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return top_.load(std::memory_order_relaxed) >= bottom_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  class Ring {
+   public:
+    explicit Ring(std::size_t capacity)
+        : mask_(capacity - 1),
+          slots_(std::make_unique<std::atomic<ValueType>[]>(capacity)) {}
+
+    [[nodiscard]] std::int64_t Capacity() const { return static_cast<std::int64_t>(mask_ + 1); }
+    void Store(std::int64_t index, ValueType value) {
+      slots_[static_cast<std::size_t>(index) & mask_].store(value, std::memory_order_relaxed);
+    }
+    ValueType Load(std::int64_t index) const {
+      return slots_[static_cast<std::size_t>(index) & mask_].load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::size_t mask_;
+    std::unique_ptr<std::atomic<ValueType>[]> slots_;
+  };
+
+  Ring* Grow(Ring* ring, std::int64_t top, std::int64_t bottom) {
+    auto grown = std::make_unique<Ring>(static_cast<std::size_t>(ring->Capacity()) * 2);
+    for (auto index = top; index < bottom; ++index) {
+      grown->Store(index, ring->Load(index));
+    }
+    rings_.push_back(std::move(grown));
+    ring_.store(rings_.back().get(), std::memory_order_release);
+    return rings_.back().get();
+  }
+
+  alignas(64) std::atomic<std::int64_t> top_{0};
+  alignas(64) std::atomic<std::int64_t> bottom_{0};
+  std::atomic<Ring*> ring_{nullptr};
+  std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+static constexpr size_t kMaxPathParams = 8;
+
+/**
+ * @brief Captured path parameters, names point into the tree and values into the matched path.
+ */
+struct PathParams {
+  std::array<std::pair<std::string_view, std::string_view>, kMaxPathParams> items{};
+  size_t size{0};
+
+  [[nodiscard]] std::optional<std::string_view> Get(std::string_view name) const {
+    for (size_t index{0}; index < size; ++index) {
+      if (items[index].first == name) {
+        return items[index].second;
+      }
+    }
+    return std::nullopt;
+  }
+};
+
+/**
+ * @brief O(1) lookup of the known headers (infra::HeaderId) of a header vector.
+ * @details One slot per known header holds the position of its first occurrence in the vector and
+ * how many times it occurred, the vector keeps every header in arrival order.
+ */
+class HeaderIndex {
+ public:
+  void Clear() { slots_.fill({}); }
+
+  void Add(infra::HeaderId id, size_t position) {
+    if (id == infra::HeaderId::kUnknown) {
+      return;
+    }
+    auto& slot = slots_[static_cast<size_t>(id)];
+    if (slot.count == 0) {
+      slot.position = static_cast<std::uint32_t>(position);
+    }
+    if (slot.count < 2) {
+      ++slot.count;
+    }
+  }
+
+  /**
+   * @return the position of the first occurrence of the header, nullopt when it is missing (a
+   * repeat is told by Count(), it never reads as missing)
+   */
+  [[nodiscard]] std::optional<size_t> Find(infra::HeaderId id) const {
+    if (id == infra::HeaderId::kUnknown) {
+      return std::nullopt;
+    }
+    const auto& slot = slots_[static_cast<size_t>(id)];
+    if (slot.count == 0) {
+      return std::nullopt;
+    }
+    return slot.position;
+  }
+
+  /**
+   * @return 0, 1, or 2 for a header that is repeated
+   */
+  [[nodiscard]] std::uint8_t Count(infra::HeaderId id) const {
+    if (id == infra::HeaderId::kUnknown) {
+      return 0;
+    }
+    return slots_[static_cast<size_t>(id)].count;
+  }
+
+ private:
+  struct Slot {
+    std::uint32_t position{0};
+    std::uint8_t count{0};  // saturates at 2, any repetition.
+  };
+
+  std::array<Slot, infra::kKnownHeaderCount> slots_{};
+};
+
+/**
+ * @brief Compressed radix tree keyed by path and method.
+ * @details Patterns are made of static text, "{name}" captures (one whole segment) and a trailing
+ * "*" or "*name" wildcard (the rest of the path). Static children are tried first, then the capture,
+ * then the wildcard, so lookups cost O(path length) and only backtrack when a static branch misses.
+ * @tparam ValueType
+ */
+template <typename ValueType>
+class PrefixTree : public DataStructure {
+ public:
+  static constexpr size_t kMethodCount = static_cast<size_t>(infra::Methods::kUnknown);
+
+  struct Match {
+    const ValueType* value{nullptr};
+    PathParams params;
+    bool path_found{false};  // the path exists but not for this method (405).
+  };
+
+ public:
+  PrefixTree()
+      : root_(std::make_unique<Node>()) {}
+
+  /**
+   * @brief Registers value for method on pattern, throws std::invalid_argument on a malformed
+   * pattern, a capture name clash or a duplicate route.
+   */
+  void Insert(infra::Methods method, std::string_view pattern, ValueType value) {
+    if (method == infra::Methods::kUnknown || pattern.empty() || pattern.front() != '/') {
+      throw std::invalid_argument("Invalid route: " + std::string(pattern));
+    }
+
+    Node* node = root_.get();
+    size_t params{0};
+    while (!pattern.empty()) {
+      if (pattern.front() == '{') {
+        auto close = pattern.find('}');
+        if (close == std::string_view::npos || close == 1 ||
+            (close + 1 < pattern.size() && pattern[close + 1] != '/') ||
+            ++params > kMaxPathParams) {
+          throw std::invalid_argument("Invalid route capture: " + std::string(pattern));
+        }
+        node = Child(node->param, pattern.substr(1, close - 1));
+        pattern.remove_prefix(close + 1);
+      } else if (pattern.front() == '*') {
+        if (pattern.find('/') != std::string_view::npos || ++params > kMaxPathParams) {
+          throw std::invalid_argument("Wildcard has to be the last segment: " +
+                                      std::string(pattern));
+        }
+        node = Child(node->wildcard, pattern.substr(1));
+        pattern = {};
+      } else {
+        auto stop = pattern.find_first_of("{*");
+        auto text = pattern.substr(0, stop);
+        if (stop != std::string_view::npos && text.back() != '/') {
+          throw std::invalid_argument("Captures have to start a segment: " +
+                                      std::string(pattern));
+        }
+        node = InsertStatic(node, text);
+        pattern.remove_prefix(text.size());
+      }
+    }
+
+    auto& slot = node->values[static_cast<size_t>(method)];
+    if (slot.has_value()) {
+      throw std::invalid_argument("Route already registered");
+    }
+    slot.emplace(std::move(value));
+    ++size_;
+  }
+
+  [[nodiscard]] Match Find(infra::Methods method, std::string_view path) const {
+    Match match;
+    if (method != infra::Methods::kUnknown) {
+      Lookup(root_.get(), path, static_cast<size_t>(method), match);
+    }
+    return match;
+  }
+
+  [[nodiscard]] size_t Size() const { return size_; }
+
+ private:
+  struct Node {
+    std::string prefix;
+    std::string indices;  // first byte of every static child, same order as children.
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> param;
+    std::unique_ptr<Node> wildcard;
+    std::string name;
+    std::array<std::optional<ValueType>, kMethodCount> values{};
+
+    [[nodiscard]] bool HasValues() const {
+      for (const auto& value : values) {
+        if (value.has_value()) {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  static Node* Child(std::unique_ptr<Node>& child, std::string_view name) {
+    if (!child) {
+      child = std::make_unique<Node>();
+      child->name = std::string(name);
+    } else if (child->name != name) {
+      throw std::invalid_argument("Conflicting capture names: " + child->name + " and " +
+                                  std::string(name));
+    }
+    return child.get();
+  }
+
+  static Node* InsertStatic(Node* node, std::string_view text) {
+    while (!text.empty()) {
+      auto index = node->indices.find(text.front());
+      if (index == std::string::npos) {
+        auto child = std::make_unique<Node>();
+        child->prefix = std::string(text);
+        node->indices.push_back(text.front());
+        node->children.push_back(std::move(child));
+        return node->children.back().get();
+      }
+
+      auto& child = node->children[index];
+      size_t common{0};
+      while (common < child->prefix.size() && common < text.size() &&
+             child->prefix[common] == text[common]) {
+        ++common;
+      }
+      if (common < child->prefix.size()) {
+        auto split = std::make_unique<Node>();
+        split->prefix = child->prefix.substr(0, common);
+        child->prefix.erase(0, common);
+        split->indices.push_back(child->prefix.front());
+        split->children.push_back(std::move(child));
+        child = std::move(split);
+      }
+      node = child.get();
+      text.remove_prefix(common);
+    }
+    return node;
+  }
+
+  static bool Lookup(const Node* node, std::string_view path, size_t method, Match& match) {
+    if (path.empty()) {
+      if (node->values[method].has_value()) {
+        match.value = &node->values[method].value();
+        return true;
+      }
+      match.path_found = match.path_found || node->HasValues();
+      return node->wildcard && Capture(node->wildcard.get(), path, method, match);
+    }
+
+    auto index = node->indices.find(path.front());
+    if (index != std::string::npos) {
+      const auto& child = node->children[index];
+      if (path.starts_with(child->prefix) &&
+          Lookup(child.get(), path.substr(child->prefix.size()), method, match)) {
+        return true;
+      }
+    }
+
+    if (node->param && match.params.size < kMaxPathParams) {
+      auto segment = path.substr(0, path.find('/'));
+      if (!segment.empty()) {
+        match.params.items[match.params.size++] = {node->param->name, segment};
+        if (Lookup(node->param.get(), path.substr(segment.size()), method, match)) {
+          return true;
+        }
+        --match.params.size;
+      }
+    }
+
+    return node->wildcard && Capture(node->wildcard.get(), path, method, match);
+  }
+
+  static bool Capture(const Node* wildcard, std::string_view rest, size_t method, Match& match) {
+    if (!wildcard->values[method].has_value()) {
+      match.path_found = match.path_found || wildcard->HasValues();
+      return false;
+    }
+    if (match.params.size < kMaxPathParams) {
+      match.params.items[match.params.size++] = {wildcard->name, rest};
+    }
+    match.value = &wildcard->values[method].value();
+    return true;
+  }
+
+  std::unique_ptr<Node> root_;
+  size_t size_{0};
+};
 
 };  // namespace datastructure
 };  // namespace camille
@@ -0,0 +1,225 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_DATE_H_
+#define CAMILLE_INCLUDE_CAMILLE_DATE_H_
+
+#include "asio/execution_context.hpp"
+#include "asio/io_context.hpp"
+#include "asio/system_timer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+/**
+ * @brief The value of the Date header, formatted once per second for the whole process.
+ * @details An Updater on one io_context (pool::ContextPool starts it on the first) rewrites the
+ * Cache when the wall clock second changes, every worker reads the 29 bytes through a seqlock and
+ * never formats, reads the clock or takes a lock.
+ */
+
+namespace camille {
+namespace date {
+
+/**
+ * @brief Length of an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+ */
+static constexpr std::size_t kHttpDateSize = 29;
+
+using HttpDate = std::array<char, kHttpDateSize>;
+
+/**
+ * @brief Writes time as an IMF-fixdate (kHttpDateSize bytes) to out.
+ */
+inline void Format(std::time_t time, char* out) {
+  static constexpr std::array<std::string_view, 7> kDays{"Sun", "Mon", "Tue", "Wed",
+                                                         "Thu", "Fri", "Sat"};
+  static constexpr std::array<std::string_view, 12> kMonths{
+      "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  std::tm utc{};
+  gmtime_r(&time, &utc);
+  auto two_digits = [](char* digits, int value) {
+    digits[0] = static_cast<char>('0' + value / 10);
+    digits[1] = static_cast<char>('0' + value % 10);
+  };
+  kDays[static_cast<std::size_t>(utc.tm_wday)].copy(out, 3);
+  out[3] = ',';
+  out[4] = ' ';
+  two_digits(out + 5, utc.tm_mday);
+  out[7] = ' ';
+  kMonths[static_cast<std::size_t>(utc.tm_mon)].copy(out + 8, 3);
+  out[11] = ' ';
+  auto year = utc.tm_year + 1900;
+  two_digits(out + 12, year / 100);
+  two_digits(out + 14, year % 100);
+  out[16] = ' ';
+  two_digits(out + 17, utc.tm_hour);
+  out[19] = ':';
+  two_digits(out + 20, utc.tm_min);
+  out[22] = ':';
+  two_digits(out + 23, utc.tm_sec);
+  std::string_view(" GMT").copy(out + 25, 4);
+}
+
+/**
+ * @brief Reads an IMF-fixdate (If-Modified-Since), the obsolete RFC 850 and asctime forms are
+ * treated as invalid.
+ */
+inline std::optional<std::time_t> Parse(std::string_view text) {
+  static constexpr std::string_view kMonths = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  if (text.size() != kHttpDateSize || text.substr(3, 2) != ", " || text.substr(25) != " GMT") {
+    return std::nullopt;
+  }
+  auto number = [text](std::size_t offset, std::size_t length, int& value) {
+    auto field = text.substr(offset, length);
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc{} && end == field.data() + field.size();
+  };
+  std::tm utc{};
+  auto month = kMonths.find(text.substr(8, 3));
+  if (month == std::string_view::npos || month % 3 != 0 || !number(5, 2, utc.tm_mday) ||
+      !number(12, 4, utc.tm_year) || !number(17, 2, utc.tm_hour) || !number(20, 2, utc.tm_min) ||
+      !number(23, 2, utc.tm_sec)) {
+    return std::nullopt;
+  }
+  utc.tm_mon = static_cast<int>(month / 3);
+  utc.tm_year -= 1900;
+  auto time = timegm(&utc);
+  if (time == -1) {
+    return std::nullopt;
+  }
+  return time;
+}
+
+/**
+ * @brief Seqlock over the formatted date, one writer (the Updater) and any number of readers.
+ * @details The text is held in atomic words so a reader racing the writer reads torn words instead
+ * of racing on plain memory, the sequence tells it to retry.
+ */
+class Cache {
+ public:
+  static Cache& Instance() {
+    static Cache cache;
+    return cache;
+  }
+
+  Cache(const Cache&) = delete;
+  Cache& operator=(const Cache&) = delete;
+
+  /**
+   * @brief Formats time unless it is the second already cached, writer side.
+   */
+  void Update(std::time_t time) {
+    if (time == second_) {
+      return;
+    }
+    second_ = time;
+    Text text{};
+    Format(time, text.data());
+    auto words = std::bit_cast<Words>(text);
+
+    auto sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t index{0}; index < kWords; ++index) {
+      words_[index].store(words[index], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  [[nodiscard]] HttpDate Read() const {
+    Words words{};
+    std::uint32_t before{0};
+    std::uint32_t after{0};
+    do {
+      before = sequence_.load(std::memory_order_acquire);
+      for (std::size_t index{0}; index < kWords; ++index) {
+        words[index] = words_[index].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence_.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1U) != 0);
+
+    auto text = std::bit_cast<Text>(words);
+    HttpDate date;
+    std::copy_n(text.begin(), kHttpDateSize, date.begin());
+    return date;
+  }
+
+ private:
+  static constexpr std::size_t kWords = (kHttpDateSize + 7) / 8;
+  using Words = std::array<std::uint64_t, kWords>;
+  using Text = std::array<char, kWords * 8>;
+
+  Cache() { Update(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())); }
+
+  alignas(64) std::atomic<std::uint32_t> sequence_{0};
+  std::array<std::atomic<std::uint64_t>, kWords> words_{};
+  std::time_t second_{-1};
+};
+
+/**
+ * @brief Refreshes the Cache on every wall clock second, registered as an io_context service
+ * (asio::use_service) on the one context that drives it.
+ */
+class Updater : public asio::execution_context::service {
+ public:
+  inline static asio::execution_context::id id;
+
+  explicit Updater(asio::io_context& io_context)
+      : asio::execution_context::service(io_context),
+        timer_(io_context) {}
+
+  Updater(const Updater&) = delete;
+  Updater& operator=(const Updater&) = delete;
+
+  /**
+   * @brief Starts the refresh, called once by the owner of the io_context (pool::ContextPool).
+   */
+  void Start() {
+    if (running_) {
+      return;
+    }
+    running_ = true;
+    Refresh();
+    Wait();
+  }
+
+ private:
+  void shutdown() override {
+    running_ = false;
+    timer_.cancel();
+  }
+
+  static void Refresh() {
+    Cache::Instance().Update(
+        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+  }
+
+  void Wait() {
+    auto now = std::chrono::system_clock::now();
+    timer_.expires_at(std::chrono::floor<std::chrono::seconds>(now) + std::chrono::seconds(1));
+    timer_.async_wait([this](const std::error_code& error_code) {
+      if (error_code || !running_) {
+        return;
+      }
+      Refresh();
+      Wait();
+    });
+  }
+
+  bool running_{false};
+  asio::system_timer timer_;
+};
+
+};  // namespace date
+};  // namespace camille
+
+#endif
@@ -12,12 +12,13 @@ enum class Errors : std::uint8_t {
   kBadMethod,
   kBadUri,
   kBadRequest,
-  kStaleParser,  // Parser was already used (one parser per transaction).
+  kStaleParser,  // Parser fed after completion without a Reset().
   kBadVersion,   // could be due to mismatch between applications or wrong version.
   kBadKey,
   kBadHeader,
   kEndOfStream,
   kSizeLimit,
+  kHeaderLimit,  // Header block larger than ParserLimits allow (bytes or fields).
   kBodyLimit,
   kBadBody,
   kBadContentLength,
@@ -45,7 +46,7 @@ static constexpr std::string_view ErrorToString(const Errors error) {
     case Errors::kBadRequest:
       return "Bad Request";
     case Errors::kStaleParser:
-      return "Stale Parser: One transaction per parser";
+      return "Stale Parser: Reset() before the next message";
     case Errors::kBadVersion:
       return "Bad Version: Protocol mismatch or invalid format";
     case Errors::kBadKey:
@@ -56,8 +57,14 @@ static constexpr std::string_view ErrorToString(const Errors error) {
       return "End of Stream reached unexpectedly";
     case Errors::kSizeLimit:
       return "Header Size Limit Exceeded";
+    case Errors::kHeaderLimit:
+      return "Header Block Limit Exceeded";
     case Errors::kBodyLimit:
       return "Body Size Limit Exceeded";
+    case Errors::kBadBody:
+      return "Bad Body";
+    case Errors::kBadContentLength:
+      return "Bad Content-Length";
     case Errors::kBufferOverflow:
       return "Internal Buffer Overflow";
     case Errors::kPartialMessage:
@@ -71,6 +78,52 @@ static constexpr std::string_view ErrorToString(const Errors error) {
   }
 }
 
+/**
+ * @brief Stable snake_case identifier of the error, for metric labels and other machine output.
+ */
+static constexpr std::string_view ErrorToLabel(const Errors error) {
+  switch (error) {
+    case Errors::kGeneralError:
+      return "general_error";
+    case Errors::kBadMethod:
+      return "bad_method";
+    case Errors::kBadUri:
+      return "bad_uri";
+    case Errors::kBadRequest:
+      return "bad_request";
+    case Errors::kStaleParser:
+      return "stale_parser";
+    case Errors::kBadVersion:
+      return "bad_version";
+    case Errors::kBadKey:
+      return "bad_key";
+    case Errors::kBadHeader:
+      return "bad_header";
+    case Errors::kEndOfStream:
+      return "end_of_stream";
+    case Errors::kSizeLimit:
+      return "size_limit";
+    case Errors::kHeaderLimit:
+      return "header_limit";
+    case Errors::kBodyLimit:
+      return "body_limit";
+    case Errors::kBadBody:
+      return "bad_body";
+    case Errors::kBadContentLength:
+      return "bad_content_length";
+    case Errors::kBufferOverflow:
+      return "buffer_overflow";
+    case Errors::kPartialMessage:
+      return "partial_message";
+    case Errors::kShortRead:
+      return "short_read";
+    case Errors::kGarbageRequest:
+      return "garbage_request";
+    default:
+      return "unknown";
+  }
+}
+
 static constexpr std::string_view ErrorToString(const NetworkError error) {
   switch (error) {
     case NetworkError::kTimeout:
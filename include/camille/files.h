@@ -0,0 +1,561 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_FILES_H_
+#define CAMILLE_INCLUDE_CAMILLE_FILES_H_
+
+#include "datastructures.h"
+#include "date.h"
+#include "infra.h"
+#include "request.h"
+#include "response.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#include <sys/syscall.h>
+#if defined(SYS_openat2)
+#define CAMILLE_OPENAT2 1
+#endif
+#endif
+
+/**
+ * @brief Static files served from a directory.
+ * @details Open descriptors and their stat results are kept in a bounded cache keyed by path, a
+ * response holds its file (and so its descriptor) until the session has written it with sendfile.
+ * Validators are an ETag built from the inode, modification time (to the nanosecond) and size and
+ * Last-Modified, a single byte range is answered with 206.
+ */
+
+namespace camille {
+namespace files {
+
+static constexpr std::size_t kDefaultCacheSize = 1024;
+static constexpr std::size_t kCacheShards = 16;
+
+struct Options {
+  /**
+   * @brief File served for a directory.
+   */
+  std::string index{"index.html"};
+  /**
+   * @brief Open files kept (descriptors and stat results).
+   */
+  std::size_t cache_size{kDefaultCacheSize};
+  /**
+   * @brief How long a cached file is trusted before it is compared with a fresh stat().
+   */
+  std::chrono::steady_clock::duration revalidate{std::chrono::seconds(1)};
+};
+
+static constexpr std::string_view kDefaultContentType = "application/octet-stream";
+
+static constexpr std::array<std::pair<std::string_view, std::string_view>, 22> kContentTypes{{
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"}}};
+
+/**
+ * @brief Content-Type by file extension (case-insensitive).
+ */
+static constexpr std::string_view ContentType(std::string_view path) {
+  auto dot = path.rfind('.');
+  if (dot == std::string_view::npos || path.find('/', dot) != std::string_view::npos) {
+    return kDefaultContentType;
+  }
+  auto extension = path.substr(dot + 1);
+  for (const auto& [known, content_type] : kContentTypes) {
+    if (infra::IEquals(extension, known)) {
+      return content_type;
+    }
+  }
+  return kDefaultContentType;
+}
+
+/**
+ * @brief An open regular file and its stat result, the descriptor is closed by the last holder
+ * (the cache once evicted, or a response still being written).
+ */
+class File {
+ public:
+  File(int fd, const struct stat& info, std::string_view content_type)
+      : fd_(fd),
+        device_(info.st_dev),
+        inode_(info.st_ino),
+        size_(static_cast<std::uint64_t>(info.st_size)),
+        modified_(info.st_mtim),
+        content_type_(content_type),
+        etag_(std::format("\"{:x}-{:x}.{:x}-{:x}\"", static_cast<std::uint64_t>(inode_),
+                          static_cast<std::uint64_t>(modified_.tv_sec),
+                          static_cast<std::uint64_t>(modified_.tv_nsec), size_)) {
+    date::Format(modified_.tv_sec, last_modified_.data());
+  }
+  ~File() { ::close(fd_); }
+
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+
+  [[nodiscard]] int Fd() const { return fd_; }
+  [[nodiscard]] std::uint64_t Size() const { return size_; }
+  [[nodiscard]] std::time_t Modified() const { return modified_.tv_sec; }
+  [[nodiscard]] std::string_view ETag() const { return etag_; }
+  [[nodiscard]] std::string_view LastModified() const {
+    return {last_modified_.data(), last_modified_.size()};
+  }
+  [[nodiscard]] std::string_view ContentType() const { return content_type_; }
+
+  /**
+   * @brief Whether info still describes this file (same inode, size and modification time).
+   */
+  [[nodiscard]] bool Same(const struct stat& info) const {
+    return info.st_dev == device_ && info.st_ino == inode_ &&
+           static_cast<std::uint64_t>(info.st_size) == size_ &&
+           info.st_mtim.tv_sec == modified_.tv_sec && info.st_mtim.tv_nsec == modified_.tv_nsec;
+  }
+
+ private:
+  int fd_;
+  dev_t device_;
+  ino_t inode_;
+  std::uint64_t size_;
+  timespec modified_;
+  std::string_view content_type_;
+  std::string etag_;
+  date::HttpDate last_modified_{};
+};
+
+using SharedFile = std::shared_ptr<const File>;
+
+/**
+ * @brief Bounded cache of the open files under root, a datastructure::ShardedCache shared by every
+ * io_context thread.
+ * @details A hit younger than the revalidate period costs no system call, an older one a stat()
+ * and a changed file is reopened. Files are opened relative to a descriptor of root with openat2()
+ * and RESOLVE_BENEATH, so a path that leaves root (through "..", an absolute or a magic link,
+ * swapped in at any time) fails in the kernel instead of between a check and the open. Kernels
+ * without openat2() walk the path one openat() at a time with O_NOFOLLOW, symbolic links are then
+ * not followed at all.
+ */
+class FileCache {
+ public:
+  /**
+   * @param capacity - at least one entry, split in up to kCacheShards shards.
+   * @throws std::invalid_argument when root cannot be opened as a directory
+   */
+  FileCache(const std::filesystem::path& root, std::size_t capacity,
+            std::chrono::steady_clock::duration revalidate)
+      : root_fd_(::open(root.c_str(), kDirectoryFlags)),
+        revalidate_(revalidate),
+        cache_(std::max(capacity, std::size_t{1}),
+               std::clamp(std::bit_floor(capacity), std::size_t{1}, kCacheShards)) {
+    if (root_fd_ < 0) {
+      throw std::invalid_argument("Not a directory: " + root.string());
+    }
+  }
+  ~FileCache() { ::close(root_fd_); }
+
+  FileCache(const FileCache&) = delete;
+  FileCache& operator=(const FileCache&) = delete;
+
+  /**
+   * @param path - relative to root, "/segment/segment" without "." or ".." segments
+   * @return the regular file at path, nullptr when it is missing, not a regular file or outside
+   * root
+   */
+  SharedFile Open(const std::string& path) {
+    auto relative = RelativePath(path);
+    if (relative.empty()) {
+      return nullptr;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto entry = cache_.Get(path);
+    if (entry.has_value() && now - entry->checked < revalidate_) {
+      return entry->file;
+    }
+
+    struct stat info {};
+    if (entry.has_value()) {
+      // the cached descriptor is only reused for the very same file, wherever the path leads now.
+      if (::fstatat(root_fd_, relative.c_str(), &info, 0) == 0 && entry->file->Same(info)) {
+        cache_.Put(path, {entry->file, now});
+        return entry->file;
+      }
+      cache_.Erase(path);
+    }
+
+    int fd = OpenBeneath(relative);
+    if (fd < 0) {
+      return nullptr;
+    }
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+      ::close(fd);
+      return nullptr;
+    }
+    auto file = std::make_shared<const File>(fd, info, files::ContentType(path));
+    cache_.Put(path, {file, now});
+    return file;
+  }
+
+ private:
+  struct Entry {
+    SharedFile file;
+    std::chrono::steady_clock::time_point checked;
+  };
+
+#if defined(O_PATH)
+  static constexpr int kDirectoryFlags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+#else
+  static constexpr int kDirectoryFlags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+#endif
+  // non-blocking so a FIFO planted under root cannot stall the io_context, fstat() rejects it.
+  static constexpr int kFileFlags = O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC;
+
+  static std::string RelativePath(std::string_view path) {
+    while (path.starts_with('/')) {
+      path.remove_prefix(1);
+    }
+    return std::string(path);
+  }
+
+  /**
+   * @return a descriptor of relative opened beneath root, -1 when it is missing or escapes
+   */
+  int OpenBeneath(const std::string& relative) {
+#if defined(CAMILLE_OPENAT2)
+    if (openat2_.load(std::memory_order_relaxed)) {
+      open_how how{};
+      how.flags = kFileFlags;
+      how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+      auto fd = static_cast<int>(::syscall(SYS_openat2, root_fd_, relative.c_str(), &how,
+                                           sizeof(how)));
+      // ENOSYS before Linux 5.6, EPERM when a seccomp filter predates the system call.
+      if (fd >= 0 || (errno != ENOSYS && errno != EPERM)) {
+        return fd;
+      }
+      openat2_.store(false, std::memory_order_relaxed);
+    }
+#endif
+    return OpenWalking(relative);
+  }
+
+  /**
+   * @brief One openat() per segment with O_NOFOLLOW, a symbolic link anywhere on the path fails.
+   */
+  int OpenWalking(std::string_view relative) const {
+    int directory = root_fd_;
+    while (true) {
+      auto slash = relative.find('/');
+      auto segment = std::string(relative.substr(0, slash));
+      if (segment.empty() || segment == "." || segment == "..") {
+        break;
+      }
+      if (slash == std::string_view::npos) {
+        int fd = ::openat(directory, segment.c_str(), kFileFlags | O_NOFOLLOW);
+        if (directory != root_fd_) {
+          ::close(directory);
+        }
+        return fd;
+      }
+      int next = ::openat(directory, segment.c_str(), kDirectoryFlags | O_NOFOLLOW);
+      if (directory != root_fd_) {
+        ::close(directory);
+      }
+      if (next < 0) {
+        return -1;
+      }
+      directory = next;
+      relative.remove_prefix(slash + 1);
+    }
+    if (directory != root_fd_) {
+      ::close(directory);
+    }
+    return -1;
+  }
+
+  int root_fd_;
+  std::chrono::steady_clock::duration revalidate_;
+  std::atomic<bool> openat2_{true};
+  datastructure::ShardedCache<std::string, Entry> cache_;
+};
+
+/**
+ * @brief Outcome of a Range header against a file of a given size.
+ */
+struct Range {
+  enum class Kind : std::uint8_t { kFull, kPartial, kUnsatisfiable };
+
+  Kind kind{Kind::kFull};
+  std::uint64_t first{0};
+  std::uint64_t last{0};
+};
+
+/**
+ * @brief Reads a single "bytes=first-last", "bytes=first-" or "bytes=-suffix" range, anything else
+ * (several ranges, another unit, bad syntax) is ignored and the whole file is sent.
+ */
+static constexpr Range ParseRange(std::string_view value, std::uint64_t size) {
+  constexpr std::string_view kUnit = "bytes=";
+  if (value.size() < kUnit.size() || !infra::IEquals(value.substr(0, kUnit.size()), kUnit) ||
+      value.find(',') != std::string_view::npos) {
+    return {};
+  }
+  value.remove_prefix(kUnit.size());
+  auto dash = value.find('-');
+  if (dash == std::string_view::npos) {
+    return {};
+  }
+  auto number = [](std::string_view text) -> std::optional<std::uint64_t> {
+    std::uint64_t parsed{0};
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (text.empty() || error != std::errc{} || end != text.data() + text.size()) {
+      return std::nullopt;
+    }
+    return parsed;
+  };
+
+  auto first_text = value.substr(0, dash);
+  auto last_text = value.substr(dash + 1);
+  if (first_text.empty()) {
+    auto suffix = number(last_text);
+    if (!suffix.has_value()) {
+      return {};
+    }
+    if (suffix.value() == 0 || size == 0) {
+      return {Range::Kind::kUnsatisfiable};
+    }
+    return {Range::Kind::kPartial, size - std::min(suffix.value(), size), size - 1};
+  }
+
+  auto first = number(first_text);
+  std::optional<std::uint64_t> last = last_text.empty() ? std::optional{size - 1}
+                                                        : number(last_text);
+  if (!first.has_value() || !last.has_value() || (!last_text.empty() && last < first)) {
+    return {};
+  }
+  if (first.value() >= size) {
+    return {Range::Kind::kUnsatisfiable};
+  }
+  return {Range::Kind::kPartial, first.value(), std::min(last.value(), size - 1)};
+}
+
+/**
+ * @brief Whether an If-None-Match list names etag (weak comparison, "*" matches any).
+ */
+static constexpr bool MatchesETag(std::string_view list, std::string_view etag) {
+  auto weak = [](std::string_view tag) { return tag.starts_with("W/") ? tag.substr(2) : tag; };
+  while (!list.empty()) {
+    auto comma = list.find(',');
+    auto item = list.substr(0, comma);
+    while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+      item.remove_prefix(1);
+    }
+    while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+      item.remove_suffix(1);
+    }
+    if (item == "*" || weak(item) == weak(etag)) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    list.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+/**
+ * @brief A directory mounted on a router (router::Router::Files), copies share the file cache.
+ */
+class StaticFiles {
+ public:
+  /**
+   * @throws std::invalid_argument when root is not a directory
+   */
+  explicit StaticFiles(const std::filesystem::path& root, Options options = {}) {
+    std::error_code error_code;
+    auto canonical = std::filesystem::canonical(root, error_code);
+    if (error_code || !std::filesystem::is_directory(canonical, error_code)) {
+      throw std::invalid_argument("Not a directory: " + root.string());
+    }
+    state_ = std::make_shared<State>(canonical.string(), std::move(options), canonical);
+  }
+
+  /**
+   * @param request
+   * @param path - relative to the root, as it appears in the URI (percent-encoded)
+   */
+  [[nodiscard]] response::Response Serve(const request::RequestView& request,
+                                         std::string_view path) const {
+    auto relative = Resolve(path);
+    if (!relative.has_value()) {
+      return response::Response{infra::StatusCodes::kNotFound};
+    }
+    auto file = relative->ends_with('/') ? nullptr : state_->cache.Open(relative.value());
+    if (!file) {
+      if (!relative->ends_with('/')) {
+        *relative += '/';
+      }
+      file = state_->cache.Open(relative.value() + state_->options.index);
+    }
+    if (!file) {
+      return response::Response{infra::StatusCodes::kNotFound};
+    }
+
+    response::Response response;
+    response.AddHeader(infra::headers::kETag, file->ETag());
+    response.AddHeader(infra::headers::kLastModified, file->LastModified());
+    if (NotModified(request, *file)) {
+      response.SetStatus(infra::StatusCodes::kNotModified);
+      return response;
+    }
+    response.AddHeader(infra::headers::kContentType, file->ContentType());
+    response.AddHeader(infra::headers::kAcceptRanges, "bytes");
+
+    auto range = Range{};
+    auto range_header = request.GetHeader(infra::HeaderId::kRange);
+    auto if_range = request.GetHeader(infra::HeaderId::kIfRange);
+    if (range_header.has_value() && (!if_range.has_value() || if_range == file->ETag() ||
+                                     if_range == file->LastModified())) {
+      range = ParseRange(range_header.value(), file->Size());
+    }
+    switch (range.kind) {
+      case Range::Kind::kUnsatisfiable:
+        response.SetStatus(infra::StatusCodes::kRangeNotSatisfiable);
+        response.AddHeader(infra::headers::kContentRange, std::format("bytes */{}", file->Size()));
+        return response;
+      case Range::Kind::kPartial:
+        response.SetStatus(infra::StatusCodes::kPartialContent);
+        response.AddHeader(infra::headers::kContentRange,
+                           std::format("bytes {}-{}/{}", range.first, range.last, file->Size()));
+        response.SetFile({file->Fd(), range.first, range.last - range.first + 1, file});
+        return response;
+      default:
+        response.SetStatus(infra::StatusCodes::kOk);
+        response.SetFile({file->Fd(), 0, file->Size(), file});
+        return response;
+    }
+  }
+
+  [[nodiscard]] const std::string& Root() const { return state_->root; }
+
+ private:
+  struct State {
+    State(std::string root_path, Options files_options, const std::filesystem::path& root_dir)
+        : root(std::move(root_path)),
+          options(std::move(files_options)),
+          cache(root_dir, options.cache_size, options.revalidate) {}
+
+    std::string root;
+    Options options;
+    FileCache cache;
+  };
+
+  /**
+   * @brief Percent-decodes path into "/segment/segment", nullopt for "..", a NUL or a bad escape.
+   * A trailing slash is kept (a directory).
+   */
+  static std::optional<std::string> Resolve(std::string_view path) {
+    std::string decoded;
+    decoded.reserve(path.size() + 1);
+    decoded += '/';
+    for (size_t index{0}; index < path.size(); ++index) {
+      char token = path[index];
+      if (token == '%') {
+        unsigned value{0};
+        if (index + 2 >= path.size()) {
+          return std::nullopt;
+        }
+        auto [end, error] =
+            std::from_chars(path.data() + index + 1, path.data() + index + 3, value, 16);
+        if (error != std::errc{} || end != path.data() + index + 3) {
+          return std::nullopt;
+        }
+        token = static_cast<char>(value);
+        index += 2;
+      }
+      if (token == '\0') {
+        return std::nullopt;
+      }
+      decoded += token;
+    }
+
+    std::string resolved;
+    resolved.reserve(decoded.size());
+    std::string_view rest = decoded;
+    while (!rest.empty()) {
+      rest.remove_prefix(1);
+      auto slash = rest.find('/');
+      auto segment = rest.substr(0, slash);
+      rest = slash == std::string_view::npos ? std::string_view{} : rest.substr(slash);
+      if (segment == "..") {
+        return std::nullopt;
+      }
+      if (!segment.empty() && segment != ".") {
+        resolved.append("/").append(segment);
+      }
+    }
+    if (decoded.ends_with('/')) {
+      resolved += '/';
+    }
+    return resolved;
+  }
+
+  /**
+   * @brief If-None-Match, or If-Modified-Since when there is no If-None-Match.
+   */
+  static bool NotModified(const request::RequestView& request, const File& file) {
+    auto if_none_match = request.GetHeader(infra::HeaderId::kIfNoneMatch);
+    if (if_none_match.has_value()) {
+      return MatchesETag(if_none_match.value(), file.ETag());
+    }
+    auto if_modified_since = request.GetHeader(infra::HeaderId::kIfModifiedSince);
+    if (if_modified_since.has_value()) {
+      auto since = date::Parse(if_modified_since.value());
+      return since.has_value() && file.Modified() <= since.value();
+    }
+    return false;
+  }
+
+  std::shared_ptr<State> state_;
+};
+
+};  // namespace files
+};  // namespace camille
+
+#endif
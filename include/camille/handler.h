@@ -1,6 +1,7 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_HANDLER_H_
 #define CAMILLE_INCLUDE_CAMILLE_HANDLER_H_
 
+#include <functional>
 #include <optional>
 #include "camille/logging.h"
 #include "request.h"
@@ -10,24 +11,64 @@
 namespace camille {
 namespace handler {
 
+static constexpr logger::Module kCamilleLogModule = logger::Module::kParser;
+
 class RequestHandler {
  public:
+  /**
+   * @brief Makes the sink of a chunked body from the head of its request, the head is only valid
+   * during the call (ToOwned() what has to last).
+   */
+  using BodyRoute = std::function<parser::Parser::BodySink(const request::RequestView&)>;
+
   RequestHandler() = default;
+  explicit RequestHandler(parser::ParserLimits limits)
+      : parser_(limits) {}
 
-  std::optional<request::Request> Parse(std::string_view data) {
-    auto req = parser_.Parse<request::Request>(data);
-    if (!parser_) {
-      CAMILLE_ERROR("Request parsing error: {} | ec: {}", parser_.GetErrorString(),
-                    parser_.GetErrorCode());
-      return std::nullopt;
-    }
+  /**
+   * @brief Parses without copying, the returned view borrows from data.
+   * @details Call ToOwned() on the result if it has to outlive the buffer behind data.
+   * @param data
+   * @return std::optional<request::RequestView>
+   */
+  std::optional<request::RequestView> Parse(std::string_view data) {
+    auto req = parser_.Parse<request::RequestView>(data);
     if (!req) {
-      CAMILLE_ERROR("Parser error, no value found");
+      CAMILLE_ERROR("Request parsing error: {} | ec: {}", error::ErrorToString(req.error()),
+                    static_cast<std::uint8_t>(req.error()));
       return std::nullopt;
     }
     return req.value();
   }
 
+  /**
+   * @brief Streaming parse over the whole unconsumed buffer, resumes from the previous call.
+   * @param data
+   * @return kPartialMessage when more bytes are needed.
+   */
+  std::expected<request::RequestView, error::Errors> Feed(std::string_view data) {
+    auto req = parser_.Feed<request::RequestView>(data);
+    if (!req && req.error() != error::Errors::kPartialMessage) {
+      CAMILLE_ERROR("Request parsing error: {} | ec: {}", error::ErrorToString(req.error()),
+                    static_cast<std::uint8_t>(req.error()));
+    }
+    return req;
+  }
+
+  void SetBodyRoute(BodyRoute route) {
+    parser_.SetHeadHook([route = std::move(route)](const parser::Parser& parser) {
+      return route(parser.Head<request::RequestView>());
+    });
+  }
+
+  [[nodiscard]] size_t Consumed() const noexcept { return parser_.Consumed(); }
+  /**
+   * @brief Bytes of a partial (chunked) message the caller can drop, see parser::Parser::Release.
+   */
+  [[nodiscard]] size_t Release() { return parser_.Release(); }
+  [[nodiscard]] bool InBody() const noexcept { return parser_.InBody(); }
+  void Reset() { parser_.Reset(); }
+
  private:
   parser::Parser parser_;
 };
@@ -1,54 +1,188 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_INFRA_H_
 #define CAMILLE_INCLUDE_CAMILLE_INFRA_H_
 
+#include <array>
+#include <bit>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <algorithm>
+#include <utility>
 
 namespace camille {
 namespace infra {
 
 namespace headers {
+static constexpr std::string_view kConnection = "Connection";
+static constexpr std::string_view kHost = "Host";
+static constexpr std::string_view kContentLength = "Content-Length";
+static constexpr std::string_view kTransferEncoding = "Transfer-Encoding";
+static constexpr std::string_view kContentType = "Content-Type";
+static constexpr std::string_view kUserAgent = "User-Agent";
+static constexpr std::string_view kSecCHUA = "Sec-CH-UA";
+static constexpr std::string_view kAccept = "Accept";
+static constexpr std::string_view kAcceptEncoding = "Accept-Encoding";
+static constexpr std::string_view kAcceptLanguage = "Accept-Language";
+static constexpr std::string_view kReferer = "Referer";
+static constexpr std::string_view kAuthorization = "Authorization";
+static constexpr std::string_view kCacheControl = "Cache-Control";
+static constexpr std::string_view kCookie = "Cookie";
+static constexpr std::string_view kDate = "Date";
+static constexpr std::string_view kExpect = "Expect";
+static constexpr std::string_view kIfMatch = "If-Match";
+static constexpr std::string_view kIfNoneMatch = "If-None-Match";
+static constexpr std::string_view kIfModifiedSince = "If-Modified-Since";
+static constexpr std::string_view kOrigin = "Origin";
+static constexpr std::string_view kRange = "Range";
+static constexpr std::string_view kUpgrade = "Upgrade";
+static constexpr std::string_view kXForwardedFor = "X-Forwarded-For";
+static constexpr std::string_view kIfRange = "If-Range";
+static constexpr std::string_view kETag = "ETag";
+static constexpr std::string_view kLastModified = "Last-Modified";
+static constexpr std::string_view kAcceptRanges = "Accept-Ranges";
+static constexpr std::string_view kContentRange = "Content-Range";
+};  // namespace headers
+
 /**
- * @todo add extra validation with the headers here (but what if someone adds a custom header? maybe
- * create a header map?)
+ * @brief ASCII case-insensitive compare, header names and most header tokens are case-insensitive.
  */
-static constexpr std::string kConnection = "Connection";
-static constexpr std::string kHost = "Host";
-static constexpr std::string kContentLength = "Content-Length";
-static const std::string kTransferEncoding = "Transfer-Encoding";
-static constexpr std::string kContentType = "Content-Type";
-static constexpr std::string kUserAgent = "User-Agent";
-static constexpr std::string kSecCHUA = "Sec-CH-UA";
-static constexpr std::string kAccept = "Accept";
-static constexpr std::string kAcceptEncoding = "Accept-Encoding";
-static constexpr std::string kAcceptLanguage = "Accept-Language";
-static constexpr std::string kReferer = "Referer";
-static constexpr std::string kAuthorization = "Authorization";
-static constexpr std::string kCacheControl = "Cache-Control";
-static constexpr std::string kCookie = "Cookie";
-<<<<<<< HEAD
-static constexpr std::string Date = "Date";
-static constexpr std::string Expect = "Expect";
-static constexpr std::string IfMatch = "If-Match";
-static constexpr std::string IfNoneMatch = "If-None-Match";
-// static constexpr std::string IfModifiedSince = "If-Modified-Since";
-static constexpr std::string Origin = "Origin";
-static constexpr std::string Range = "Range";
-// static constexpr std::string TransferEncoding = "Transfer-Encoding";
-static constexpr std::string Upgrade = "Upgrade";
-static constexpr std::string XForwardedFor = "X-Forwarded-For";
-=======
-static constexpr std::string kDate = "Date";
-static constexpr std::string kExpect = "Expect";
-static constexpr std::string kIfMatch = "If-Match";
-static constexpr std::string kIfNoneMatch = "If-None-Match";
-static const std::string kIfModifiedSince = "If-Modified-Since";
-static constexpr std::string kOrigin = "Origin";
-static constexpr std::string kRange = "Range";
-static constexpr std::string kUpgrade = "Upgrade";
-static constexpr std::string kXForwardedFor = "X-Forwarded-For";
->>>>>>> development
-};  // namespace headers
+static constexpr bool IEquals(std::string_view lhs, std::string_view rhs) {
+  auto lower = [](char token) {
+    return (token >= 'A' && token <= 'Z') ? static_cast<char>(token | 0x20) : token;
+  };
+  return std::ranges::equal(lhs, rhs,
+                            [&lower](char left, char right) { return lower(left) == lower(right); });
+}
+
+/**
+ * @brief Known header names, the id is the index of the name in kKnownHeaders.
+ */
+enum class HeaderId : std::uint8_t {
+  kConnection,
+  kHost,
+  kContentLength,
+  kTransferEncoding,
+  kContentType,
+  kUserAgent,
+  kSecCHUA,
+  kAccept,
+  kAcceptEncoding,
+  kAcceptLanguage,
+  kReferer,
+  kAuthorization,
+  kCacheControl,
+  kCookie,
+  kDate,
+  kExpect,
+  kIfMatch,
+  kIfNoneMatch,
+  kIfModifiedSince,
+  kOrigin,
+  kRange,
+  kUpgrade,
+  kXForwardedFor,
+  kIfRange,
+  kETag,
+  kLastModified,
+  kAcceptRanges,
+  kContentRange,
+  kUnknown
+};
+
+static constexpr std::size_t kKnownHeaderCount = static_cast<std::size_t>(HeaderId::kUnknown);
+
+static constexpr std::array<std::string_view, kKnownHeaderCount> kKnownHeaders = {
+    headers::kConnection,       headers::kHost,           headers::kContentLength,
+    headers::kTransferEncoding, headers::kContentType,    headers::kUserAgent,
+    headers::kSecCHUA,          headers::kAccept,         headers::kAcceptEncoding,
+    headers::kAcceptLanguage,   headers::kReferer,        headers::kAuthorization,
+    headers::kCacheControl,     headers::kCookie,         headers::kDate,
+    headers::kExpect,           headers::kIfMatch,        headers::kIfNoneMatch,
+    headers::kIfModifiedSince,  headers::kOrigin,         headers::kRange,
+    headers::kUpgrade,          headers::kXForwardedFor,  headers::kIfRange,
+    headers::kETag,             headers::kLastModified,   headers::kAcceptRanges,
+    headers::kContentRange};
+
+/**
+ * @brief FNV-1a over the lowercased name (| 0x20 folds the letters, '-' and digits are unchanged).
+ * The high half is folded in at the end, the low bits of FNV-1a only depend on the low bits of
+ * the seed so the slot (a power of two modulo) would otherwise ignore most seeds.
+ */
+static constexpr std::uint32_t HeaderHash(std::string_view name, std::uint32_t seed) {
+  std::uint32_t hash = seed;
+  for (char token : name) {
+    hash = (hash ^ static_cast<std::uint8_t>(token | 0x20)) * 16777619U;
+  }
+  return hash ^ (hash >> 16);
+}
+
+/**
+ * @brief Perfect hash of kKnownHeaders, the seed is searched at compile time so that every known
+ * name lands in its own slot.
+ */
+struct HeaderTable {
+  static constexpr std::size_t kSlots = 128;
+
+  std::uint32_t seed{0};
+  std::array<HeaderId, kSlots> slots{};
+};
+
+static constexpr HeaderTable kHeaderTable = []() consteval {
+  HeaderTable table;
+  for (std::uint32_t seed{1}; seed < 4096; ++seed) {
+    table.seed = seed;
+    table.slots.fill(HeaderId::kUnknown);
+    bool perfect = true;
+    for (std::size_t index{0}; index < kKnownHeaderCount && perfect; ++index) {
+      auto& slot = table.slots[HeaderHash(kKnownHeaders[index], seed) % HeaderTable::kSlots];
+      perfect = slot == HeaderId::kUnknown;
+      slot = static_cast<HeaderId>(index);
+    }
+    if (perfect) {
+      return table;
+    }
+  }
+  table.seed = 0;
+  return table;
+}();
+static_assert(kHeaderTable.seed != 0, "No perfect hash seed for the known headers");
+
+/**
+ * @brief Case-insensitive id of a header name, one hash and one compare against the only
+ * candidate.
+ */
+static constexpr HeaderId HeaderEnum(std::string_view name) {
+  auto id = kHeaderTable.slots[HeaderHash(name, kHeaderTable.seed) % HeaderTable::kSlots];
+  if (id == HeaderId::kUnknown || !IEquals(name, kKnownHeaders[static_cast<std::size_t>(id)])) {
+    return HeaderId::kUnknown;
+  }
+  return id;
+}
+
+/**
+ * @brief Looks for token in a comma separated header value (e.g. "Connection: keep-alive, Upgrade").
+ */
+static constexpr bool HasToken(std::string_view list, std::string_view token) {
+  while (!list.empty()) {
+    auto comma = list.find(',');
+    auto item = list.substr(0, comma);
+    while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+      item.remove_prefix(1);
+    }
+    while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+      item.remove_suffix(1);
+    }
+    if (IEquals(item, token)) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    list.remove_prefix(comma + 1);
+  }
+  return false;
+}
 
 enum class Methods : std::uint8_t {
   kGet,
@@ -64,49 +198,264 @@ enum class Methods : std::uint8_t {
   kUnknown
 };
 
-static constexpr Methods MethodEnum(std::string_view method) {
+static constexpr std::size_t kMethodCount = static_cast<std::size_t>(Methods::kUnknown);
+
+/**
+ * @brief Name of every method in enum order, a method is registered with its enumerator and its
+ * name here (e.g. "PURGE" or the WebDAV "PROPFIND").
+ */
+static constexpr std::array<std::string_view, kMethodCount> kMethodNames = {
+    "GET", "HEAD", "POST", "PATCH", "PUT", "DELETE", "OPTIONS", "CONNECT", "TRACE"};
+
+/**
+ * @brief Classifies the method of a request line with masked 8 byte compares.
+ * @details Every entry is the first 8 bytes of "NAME " and a mask over them, the line is loaded
+ * once as an integer and matches an entry when (word & mask) == pattern, the trailing space
+ * included. Names of 8 bytes and more compare the rest of the name after the word.
+ * @tparam N
+ */
+template <std::size_t N>
+class MethodTable {
+ public:
+  struct Match {
+    Methods method{Methods::kUnknown};
+    std::size_t length{0};  // of the name, the space follows it.
+  };
+
+  consteval explicit MethodTable(const std::array<std::string_view, N>& names) {
+    for (std::size_t index{0}; index < N; ++index) {
+      const auto name = names[index];
+      if (name.empty() || name.find(' ') != std::string_view::npos) {
+        throw "Method names are non-empty tokens";
+      }
+      std::array<unsigned char, sizeof(std::uint64_t)> pattern{};
+      std::array<unsigned char, sizeof(std::uint64_t)> mask{};
+      for (std::size_t byte{0}; byte < pattern.size() && byte <= name.size(); ++byte) {
+        pattern[byte] = byte < name.size() ? static_cast<unsigned char>(name[byte]) : ' ';
+        mask[byte] = 0xFF;
+      }
+      entries_[index] = {std::bit_cast<std::uint64_t>(pattern), std::bit_cast<std::uint64_t>(mask),
+                         name, static_cast<Methods>(index)};
+    }
+  }
+
   /**
-   * @brief Cannot switch-case on string_view
+   * @param line - the request line (at least up to the space after the method)
    */
-  if (method == "GET") {
-    return Methods::kGet;
-  }
-  if (method == "POST") {
-    return Methods::kPost;
-  }
-  if (method == "PUT") {
-    return Methods::kPut;
-  }
-  if (method == "DELETE") {
-    return Methods::kDelete;
-  }
-  if (method == "PATCH") {
-    return Methods::kPatch;
-  }
-  if (method == "HEAD") {
-    return Methods::kHead;
+  [[nodiscard]] Match Classify(std::string_view line) const {
+    std::uint64_t word{0};
+    std::memcpy(&word, line.data(), std::min(line.size(), sizeof(word)));
+    for (const auto& entry : entries_) {
+      if ((word & entry.mask) != entry.pattern) {
+        continue;
+      }
+      if (entry.name.size() >= sizeof(word) &&
+          (line.size() <= entry.name.size() || line[entry.name.size()] != ' ' ||
+           line.substr(sizeof(word), entry.name.size() - sizeof(word)) !=
+               entry.name.substr(sizeof(word)))) {
+        continue;
+      }
+      return {entry.method, entry.name.size()};
+    }
+    return {};
   }
-  if (method == "OPTIONS") {
-    return Methods::kOptions;
-  }
-  if (method == "TRACE") {
-    return Methods::kTrace;
-  }
-  if (method == "CONNECT") {
-    return Methods::kConnect;
+
+ private:
+  struct Entry {
+    std::uint64_t pattern{0};
+    std::uint64_t mask{0};
+    std::string_view name;
+    Methods method{Methods::kUnknown};
+  };
+
+  std::array<Entry, N> entries_{};
+};
+
+static constexpr MethodTable kMethodTable{kMethodNames};
+
+static constexpr Methods MethodEnum(std::string_view method) {
+  for (std::size_t index{0}; index < kMethodCount; ++index) {
+    if (method == kMethodNames[index]) {
+      return static_cast<Methods>(index);
+    }
   }
   return Methods::kUnknown;
 }
 
-// TODO: need to fill the rest, change the name to the error itself
+static constexpr std::string_view MethodToString(const Methods method) {
+  auto index = static_cast<std::size_t>(method);
+  return index < kMethodCount ? kMethodNames[index] : "UNKNOWN";
+}
+
+/**
+ * @brief The status codes of RFC 9110.
+ */
 enum class StatusCodes : std::uint16_t {
-  HTTP_100 = 100,
-  HTTP_200 = 200,
-  HTTP_300 = 300,
-  HTTP_400 = 400,
-  HTTP_500 = 500
+  kContinue = 100,
+  kSwitchingProtocols = 101,
+
+  kOk = 200,
+  kCreated = 201,
+  kAccepted = 202,
+  kNonAuthoritativeInformation = 203,
+  kNoContent = 204,
+  kResetContent = 205,
+  kPartialContent = 206,
+
+  kMultipleChoices = 300,
+  kMovedPermanently = 301,
+  kFound = 302,
+  kSeeOther = 303,
+  kNotModified = 304,
+  kUseProxy = 305,
+  kTemporaryRedirect = 307,
+  kPermanentRedirect = 308,
+
+  kBadRequest = 400,
+  kUnauthorized = 401,
+  kPaymentRequired = 402,
+  kForbidden = 403,
+  kNotFound = 404,
+  kMethodNotAllowed = 405,
+  kNotAcceptable = 406,
+  kProxyAuthenticationRequired = 407,
+  kRequestTimeout = 408,
+  kConflict = 409,
+  kGone = 410,
+  kLengthRequired = 411,
+  kPreconditionFailed = 412,
+  kContentTooLarge = 413,
+  kUriTooLong = 414,
+  kUnsupportedMediaType = 415,
+  kRangeNotSatisfiable = 416,
+  kExpectationFailed = 417,
+  kMisdirectedRequest = 421,
+  kUnprocessableContent = 422,
+  kUpgradeRequired = 426,
+  kRequestHeaderFieldsTooLarge = 431,
+
+  kInternalServerError = 500,
+  kNotImplemented = 501,
+  kBadGateway = 502,
+  kServiceUnavailable = 503,
+  kGatewayTimeout = 504,
+  kHttpVersionNotSupported = 505
+};
+
+static constexpr std::array<std::pair<StatusCodes, std::string_view>, 45> kReasonPhrases{{
+    {StatusCodes::kContinue, "Continue"},
+    {StatusCodes::kSwitchingProtocols, "Switching Protocols"},
+    {StatusCodes::kOk, "OK"},
+    {StatusCodes::kCreated, "Created"},
+    {StatusCodes::kAccepted, "Accepted"},
+    {StatusCodes::kNonAuthoritativeInformation, "Non-Authoritative Information"},
+    {StatusCodes::kNoContent, "No Content"},
+    {StatusCodes::kResetContent, "Reset Content"},
+    {StatusCodes::kPartialContent, "Partial Content"},
+    {StatusCodes::kMultipleChoices, "Multiple Choices"},
+    {StatusCodes::kMovedPermanently, "Moved Permanently"},
+    {StatusCodes::kFound, "Found"},
+    {StatusCodes::kSeeOther, "See Other"},
+    {StatusCodes::kNotModified, "Not Modified"},
+    {StatusCodes::kUseProxy, "Use Proxy"},
+    {StatusCodes::kTemporaryRedirect, "Temporary Redirect"},
+    {StatusCodes::kPermanentRedirect, "Permanent Redirect"},
+    {StatusCodes::kBadRequest, "Bad Request"},
+    {StatusCodes::kUnauthorized, "Unauthorized"},
+    {StatusCodes::kPaymentRequired, "Payment Required"},
+    {StatusCodes::kForbidden, "Forbidden"},
+    {StatusCodes::kNotFound, "Not Found"},
+    {StatusCodes::kMethodNotAllowed, "Method Not Allowed"},
+    {StatusCodes::kNotAcceptable, "Not Acceptable"},
+    {StatusCodes::kProxyAuthenticationRequired, "Proxy Authentication Required"},
+    {StatusCodes::kRequestTimeout, "Request Timeout"},
+    {StatusCodes::kConflict, "Conflict"},
+    {StatusCodes::kGone, "Gone"},
+    {StatusCodes::kLengthRequired, "Length Required"},
+    {StatusCodes::kPreconditionFailed, "Precondition Failed"},
+    {StatusCodes::kContentTooLarge, "Content Too Large"},
+    {StatusCodes::kUriTooLong, "URI Too Long"},
+    {StatusCodes::kUnsupportedMediaType, "Unsupported Media Type"},
+    {StatusCodes::kRangeNotSatisfiable, "Range Not Satisfiable"},
+    {StatusCodes::kExpectationFailed, "Expectation Failed"},
+    {StatusCodes::kMisdirectedRequest, "Misdirected Request"},
+    {StatusCodes::kUnprocessableContent, "Unprocessable Content"},
+    {StatusCodes::kUpgradeRequired, "Upgrade Required"},
+    {StatusCodes::kRequestHeaderFieldsTooLarge, "Request Header Fields Too Large"},
+    {StatusCodes::kInternalServerError, "Internal Server Error"},
+    {StatusCodes::kNotImplemented, "Not Implemented"},
+    {StatusCodes::kBadGateway, "Bad Gateway"},
+    {StatusCodes::kServiceUnavailable, "Service Unavailable"},
+    {StatusCodes::kGatewayTimeout, "Gateway Timeout"},
+    {StatusCodes::kHttpVersionNotSupported, "HTTP Version Not Supported"}}};
+
+static constexpr std::size_t kMaxStatusCode = 600;
+
+/**
+ * @brief Every "HTTP/1.1 NNN Reason\r\n" line back to back, indexed by code.
+ */
+template <std::size_t Size>
+struct StatusLineTable {
+  std::array<char, Size> text{};
+  std::array<std::uint16_t, kMaxStatusCode> offsets{};
+  std::array<std::uint8_t, kMaxStatusCode> lengths{};
 };
 
+static constexpr std::string_view kStatusLineVersion = "HTTP/1.1 ";
+static constexpr std::string_view kCrlf = "\r\n";
+
+static constexpr std::size_t kStatusLinesSize = []() consteval {
+  std::size_t size{0};
+  for (const auto& [status_code, reason] : kReasonPhrases) {
+    size += kStatusLineVersion.size() + 4 + reason.size() + kCrlf.size();
+  }
+  return size;
+}();
+
+static constexpr StatusLineTable<kStatusLinesSize> kStatusLines = []() consteval {
+  StatusLineTable<kStatusLinesSize> table;
+  std::size_t offset{0};
+  auto append = [&table, &offset](std::string_view text) {
+    for (char token : text) {
+      table.text[offset++] = token;
+    }
+  };
+  for (const auto& [status_code, reason] : kReasonPhrases) {
+    auto code = static_cast<std::size_t>(status_code);
+    auto begin = offset;
+    append(kStatusLineVersion);
+    table.text[offset++] = static_cast<char>('0' + code / 100);
+    table.text[offset++] = static_cast<char>('0' + code / 10 % 10);
+    table.text[offset++] = static_cast<char>('0' + code % 10);
+    table.text[offset++] = ' ';
+    append(reason);
+    append(kCrlf);
+    table.offsets[code] = static_cast<std::uint16_t>(begin);
+    table.lengths[code] = static_cast<std::uint8_t>(offset - begin);
+  }
+  return table;
+}();
+
+/**
+ * @return "HTTP/1.1 NNN Reason\r\n", empty for a code outside kReasonPhrases
+ */
+static constexpr std::string_view StatusLine(StatusCodes status_code) {
+  auto code = static_cast<std::size_t>(status_code);
+  if (code >= kMaxStatusCode || kStatusLines.lengths[code] == 0) {
+    return {};
+  }
+  return {kStatusLines.text.data() + kStatusLines.offsets[code], kStatusLines.lengths[code]};
+}
+
+static constexpr std::string_view ReasonPhrase(StatusCodes status_code) {
+  auto line = StatusLine(status_code);
+  if (line.empty()) {
+    return "Unknown";
+  }
+  auto prefix = kStatusLineVersion.size() + 4;
+  return line.substr(prefix, line.size() - prefix - kCrlf.size());
+}
+
 };  // namespace infra
 };  // namespace camille
 
@@ -3,13 +3,49 @@
 
 #include "types.h"
 
-#include <print>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <format>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#if defined(CAMILLE_LOG_SPDLOG)
+#include "spdlog/sinks/sink.h"
+#endif
+
+#define CAMILLE_LEVEL_TRACE 0
+#define CAMILLE_LEVEL_DEBUG 1
+#define CAMILLE_LEVEL_INFO 2
+#define CAMILLE_LEVEL_WARNING 3
+#define CAMILLE_LEVEL_ERROR 4
+#define CAMILLE_LEVEL_CRITICAL 5
+#define CAMILLE_LEVEL_OFF 6
+
+/**
+ * @brief Lowest level compiled in, the macros below it expand to nothing (their arguments are not
+ * evaluated), e.g. -DCAMILLE_ACTIVE_LEVEL=CAMILLE_LEVEL_INFO for production builds.
+ */
+#if !defined(CAMILLE_ACTIVE_LEVEL)
+#define CAMILLE_ACTIVE_LEVEL CAMILLE_LEVEL_TRACE
+#endif
 
 /**
  * @brief Camille Logging Functionality
- * @todo maybe just use spdlog async logger?
+ * @details Records are formatted on the calling thread into a thread local buffer (arguments are
+ * often views into request buffers, so nothing is deferred past the call), pushed on that thread's
+ * SPSC ring and written in batches by a single flusher thread. No lock and no syscall on the io
+ * threads. Levels are checked before any of that: CAMILLE_ACTIVE_LEVEL at compile time, then the
+ * runtime threshold of the calling module.
  * @todo add an option to write a test to file, follow benchmarks.
  */
 
@@ -40,9 +76,400 @@ static constexpr std::string_view TrimPath(std::string_view path) {
   return path.substr(std::distance(path.cbegin(), second_last));
 }
 
+enum class Level : std::uint8_t {
+  kTrace = CAMILLE_LEVEL_TRACE,
+  kDebug = CAMILLE_LEVEL_DEBUG,
+  kInfo = CAMILLE_LEVEL_INFO,
+  kWarning = CAMILLE_LEVEL_WARNING,
+  kError = CAMILLE_LEVEL_ERROR,
+  kCritical = CAMILLE_LEVEL_CRITICAL,
+  kOff = CAMILLE_LEVEL_OFF
+};
+
+enum class Module : std::uint8_t { kGeneral, kParser, kNetwork, kPool };
+static constexpr std::size_t kModuleCount = 4;
+
+/**
+ * @brief Runtime threshold until SetLevel(), everything compiled in is logged as before the
+ * thresholds existed; build with -DCAMILLE_LOG_LEVEL=INFO to drop the debug and trace records.
+ */
+static constexpr Level kDefaultLevel = static_cast<Level>(CAMILLE_ACTIVE_LEVEL);
+
+/**
+ * @brief Longest record, longer messages are truncated and end with "...".
+ */
+static constexpr std::size_t kMaxRecordSize = 4 * 1024;
+static constexpr std::size_t kRingSize = 256 * 1024;
+static constexpr std::chrono::milliseconds kFlushInterval{5};
+
+/**
+ * @brief What a thread does when its ring is full: drop the record (counted and reported by the
+ * flusher) or wait for the flusher to make room.
+ */
+enum class Overflow : std::uint8_t { kDrop, kBlock };
+
+class Sink {
+ public:
+  virtual ~Sink() = default;
+  /**
+   * @brief Newline terminated records, one flush worth.
+   */
+  virtual void Write(std::string_view batch) = 0;
+  virtual void Flush() {}
+};
+
+class StdoutSink : public Sink {
+ public:
+  void Write(std::string_view batch) override { std::fwrite(batch.data(), 1, batch.size(), stdout); }
+  void Flush() override { std::fflush(stdout); }
+};
+
+class FileSink : public Sink {
+ public:
+  explicit FileSink(const std::string& path)
+      : file_(std::fopen(path.c_str(), "a")) {
+    if (file_ == nullptr) {
+      throw std::runtime_error("Error when trying to open log file " + path);
+    }
+  }
+  ~FileSink() override { std::fclose(file_); }
+
+  FileSink(const FileSink&) = delete;
+  FileSink& operator=(const FileSink&) = delete;
+
+  void Write(std::string_view batch) override { std::fwrite(batch.data(), 1, batch.size(), file_); }
+  void Flush() override { std::fflush(file_); }
+
+ private:
+  std::FILE* file_;
+};
+
+#if defined(CAMILLE_LOG_SPDLOG)
+/**
+ * @brief Forwards every record to a bundled spdlog sink, as is (pattern "%v").
+ */
+class SpdlogSink : public Sink {
+ public:
+  explicit SpdlogSink(std::shared_ptr<spdlog::sinks::sink> sink)
+      : sink_(std::move(sink)) {
+    sink_->set_pattern("%v");
+  }
+
+  void Write(std::string_view batch) override {
+    while (!batch.empty()) {
+      auto end = batch.find('\n');
+      auto line = batch.substr(0, end);
+      sink_->log(spdlog::details::log_msg("camille", spdlog::level::info,
+                                          spdlog::string_view_t(line.data(), line.size())));
+      batch.remove_prefix(end == std::string_view::npos ? batch.size() : end + 1);
+    }
+  }
+  void Flush() override { sink_->flush(); }
+
+ private:
+  std::shared_ptr<spdlog::sinks::sink> sink_;
+};
+#endif
+
+/**
+ * @brief Single producer (the owning thread) single consumer (the flusher) byte ring of length
+ * prefixed records.
+ * @details Positions grow monotonically, a record that does not fit before the end of the buffer
+ * leaves a wrap marker and starts over at offset 0.
+ */
+class Ring {
+ public:
+  explicit Ring(std::size_t size = kRingSize)
+      : buffer_(std::make_unique<char[]>(size)),
+        size_(size) {}
+
+  bool TryPush(std::string_view record) {
+    const std::size_t need = Align(sizeof(std::uint32_t) + record.size());
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t offset = tail & (size_ - 1);
+    std::size_t skip = size_ - offset < need ? size_ - offset : 0;
+    if (size_ - (tail - cached_head_) < skip + need) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (size_ - (tail - cached_head_) < skip + need) {
+        return false;
+      }
+    }
+    if (skip != 0) {
+      std::memcpy(buffer_.get() + offset, &kWrap, sizeof(kWrap));
+      tail += skip;
+      offset = 0;
+    }
+    auto length = static_cast<std::uint32_t>(record.size());
+    std::memcpy(buffer_.get() + offset, &length, sizeof(length));
+    std::memcpy(buffer_.get() + offset + sizeof(length), record.data(), record.size());
+    tail_.store(tail + need, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Consumer side, hands every queued record to sink then frees their space.
+   * @return records drained
+   */
+  template <typename Function>
+  std::size_t Drain(Function&& sink) {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    const std::size_t tail = tail_.load(std::memory_order_acquire);
+    std::size_t count{0};
+    while (head != tail) {
+      std::size_t offset = head & (size_ - 1);
+      std::uint32_t length{0};
+      std::memcpy(&length, buffer_.get() + offset, sizeof(length));
+      if (length == kWrap) {
+        head += size_ - offset;
+        continue;
+      }
+      sink(std::string_view(buffer_.get() + offset + sizeof(length), length));
+      head += Align(sizeof(length) + length);
+      ++count;
+    }
+    head_.store(head, std::memory_order_release);
+    return count;
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+  void Drop() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+  std::uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+ private:
+  static constexpr std::uint32_t kWrap = 0xffffffff;
+
+  static constexpr std::size_t Align(std::size_t size) {
+    return (size + alignof(std::uint32_t) - 1) & ~(alignof(std::uint32_t) - 1);
+  }
+
+  std::unique_ptr<char[]> buffer_;
+  std::size_t size_;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::size_t cached_head_{0};
+  std::atomic<std::uint64_t> dropped_{0};
+};
+
+/**
+ * @brief Owns the rings of every logging thread and the flusher that empties them into the sink.
+ * @details Lives for the whole process, at exit the flusher is stopped and the rings drained, the
+ * calls that come after that write to the sink synchronously.
+ */
+class AsyncLogger {
+ public:
+  static AsyncLogger& Instance() {
+    static AsyncLogger* logger = []() {
+      auto* created = new AsyncLogger();
+      std::atexit([]() { AsyncLogger::Instance().Shutdown(); });
+      return created;
+    }();
+    return *logger;
+  }
+
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  void SetSink(std::unique_ptr<Sink> sink) {
+    std::lock_guard lock(mutex_);
+    sink_->Flush();
+    sink_ = std::move(sink);
+  }
+
+  void SetOverflow(Overflow overflow) { overflow_.store(overflow, std::memory_order_relaxed); }
+
+  void Push(std::string_view record) {
+    if (!running_.load(std::memory_order_acquire)) {
+      std::lock_guard lock(mutex_);
+      batch_.append(record).push_back('\n');
+      WriteBatch();
+      return;
+    }
+    Ring& ring = ThreadRing();
+    while (!ring.TryPush(record)) {
+      if (overflow_.load(std::memory_order_relaxed) == Overflow::kDrop) {
+        ring.Drop();
+        return;
+      }
+      urgent_.store(true, std::memory_order_relaxed);
+      wake_.notify_one();
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * @brief Writes out everything pushed so far (by any thread) before returning.
+   */
+  void Flush() {
+    std::lock_guard lock(mutex_);
+    DrainLocked();
+  }
+
+  void Shutdown() {
+    if (!running_.exchange(false)) {
+      return;
+    }
+    flusher_.request_stop();
+    wake_.notify_one();
+    if (flusher_.joinable()) {
+      flusher_.join();
+    }
+    Flush();
+  }
+
+ private:
+  AsyncLogger()
+      : sink_(std::make_unique<StdoutSink>()),
+        flusher_([this](std::stop_token stop) { Run(stop); }) {}
+
+  Ring& ThreadRing() {
+    thread_local std::shared_ptr<Ring> ring = [this]() {
+      auto created = std::make_shared<Ring>();
+      std::lock_guard lock(mutex_);
+      rings_.push_back(created);
+      return created;
+    }();
+    return *ring;
+  }
+
+  void Run(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+      std::unique_lock lock(mutex_);
+      if (DrainLocked() == 0) {
+        wake_.wait_for(lock, stop, kFlushInterval,
+                       [this] { return urgent_.exchange(false, std::memory_order_relaxed); });
+      }
+    }
+  }
+
+  /**
+   * @brief Empties every ring into one batch and hands it to the sink, rings of exited threads are
+   * released once empty. Called with mutex_ held, which also keeps a single consumer per ring.
+   */
+  std::size_t DrainLocked() {
+    std::size_t count{0};
+    for (auto it = rings_.begin(); it != rings_.end();) {
+      auto& ring = **it;
+      count += ring.Drain([this](std::string_view record) {
+        batch_.append(record).push_back('\n');
+      });
+      if (auto dropped = ring.TakeDropped(); dropped != 0) {
+        std::format_to(std::back_inserter(batch_), "[logger] dropped {} records, ring full\n",
+                       dropped);
+      }
+      if (it->use_count() == 1 && ring.Empty()) {
+        it = rings_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    WriteBatch();
+    return count;
+  }
+
+  void WriteBatch() {
+    if (batch_.empty()) {
+      return;
+    }
+    sink_->Write(batch_);
+    sink_->Flush();
+    batch_.clear();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::atomic<bool> running_{true};
+  std::atomic<bool> urgent_{false};
+  std::atomic<Overflow> overflow_{Overflow::kDrop};
+  std::unique_ptr<Sink> sink_;
+  std::string batch_;
+  types::camille::CamilleVector<std::shared_ptr<Ring>> rings_;
+  std::jthread flusher_;
+};
+
+/**
+ * @brief "[YYYY-MM-DD HH:MM:SS UTC] ", formatted once per second per thread.
+ */
+inline std::string_view Timestamp() {
+  thread_local std::chrono::sys_seconds last{};
+  thread_local std::array<char, 32> text{};
+  thread_local std::size_t size{0};
+  auto now = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now());
+  if (now != last || size == 0) {
+    last = now;
+    auto result = std::format_to_n(text.data(), text.size(), "[{:%F %T} UTC] ", now);
+    size = static_cast<std::size_t>(result.out - text.data());
+  }
+  return {text.data(), size};
+}
+
+/**
+ * @brief Runtime thresholds, one relaxed load per call and nothing is formatted below it.
+ * @details A module follows the global level until it is given its own.
+ */
+class Levels {
+ public:
+  static Levels& Instance() {
+    static Levels levels;
+    return levels;
+  }
+
+  [[nodiscard]] bool Enabled(Level level, Module module) const {
+    return level >= thresholds_[static_cast<std::size_t>(module)].load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] Level Get(Module module) const {
+    return thresholds_[static_cast<std::size_t>(module)].load(std::memory_order_relaxed);
+  }
+
+  void Set(Level level) {
+    std::lock_guard lock(mutex_);
+    global_ = level;
+    for (std::size_t index{0}; index < kModuleCount; ++index) {
+      if (!overridden_[index]) {
+        thresholds_[index].store(level, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void Set(Module module, Level level) {
+    std::lock_guard lock(mutex_);
+    overridden_[static_cast<std::size_t>(module)] = true;
+    thresholds_[static_cast<std::size_t>(module)].store(level, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief The module follows the global level again.
+   */
+  void Reset(Module module) {
+    std::lock_guard lock(mutex_);
+    overridden_[static_cast<std::size_t>(module)] = false;
+    thresholds_[static_cast<std::size_t>(module)].store(global_, std::memory_order_relaxed);
+  }
+
+ private:
+  Levels() {
+    for (auto& threshold : thresholds_) {
+      threshold.store(kDefaultLevel, std::memory_order_relaxed);
+    }
+  }
+
+  std::mutex mutex_;
+  Level global_{kDefaultLevel};
+  std::array<bool, kModuleCount> overridden_{};
+  std::array<std::atomic<Level>, kModuleCount> thresholds_;
+};
+
+inline bool Enabled(Level level, Module module) { return Levels::Instance().Enabled(level, module); }
+inline void SetLevel(Level level) { Levels::Instance().Set(level); }
+inline void SetLevel(Module module, Level level) { Levels::Instance().Set(module, level); }
+inline void ResetLevel(Module module) { Levels::Instance().Reset(module); }
+inline Level GetLevel(Module module = Module::kGeneral) { return Levels::Instance().Get(module); }
+
 /**
  * @brief Core logging logic
- * @todo should maybe "downgrade" into cout?
  * @version 23
  * @param level
  * @param file
@@ -56,36 +483,79 @@ inline void InternalLog(std::string_view level,
                         int line,
                         std::format_string<Args...> message,
                         Args&&... args) {
-  auto now = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now());
-  std::string formatted_message = std::format(message, std::forward<Args>(args)...);
-  std::println("[{:%F %T} UTC] [{}] [{}:{}] {}", now, level, file, line, formatted_message);
-  // std::cout << std::format("[{:%F %T} UTC] ", now) << "[" << level << "] "
-  //           << "[" << file << ":" << line << "] " << formatted_message << "\n";
+  thread_local std::array<char, kMaxRecordSize> record;
+  char* const begin = record.data();
+  char* const end = begin + record.size();
+  auto prefix = Timestamp();
+  std::memcpy(begin, prefix.data(), prefix.size());
+  char* out = begin + prefix.size();
+  out = std::format_to_n(out, end - out, "[{}] [{}:{}] ", level, file, line).out;
+  auto body = std::format_to_n(out, end - out, message, std::forward<Args>(args)...);
+  if (static_cast<std::ptrdiff_t>(body.size) > end - out) {
+    std::memcpy(end - 3, "...", 3);
+  }
+  out = body.out;
+  AsyncLogger::Instance().Push({begin, static_cast<std::size_t>(out - begin)});
 }
 
-#define CAMILLE(message, ...)                                                                     \
-  camille::logger::InternalLog("CAMILLE", camille::logger::TrimPath(__FILE__), __LINE__, message, \
-                               ##__VA_ARGS__)
-#define CAMILLE_TRACE(message, ...)                                                         \
-  camille::logger::InternalLog("\033[32mTRACE\033[0m", camille::logger::TrimPath(__FILE__), \
-                               __LINE__, message, ##__VA_ARGS__)
-#define CAMILLE_DEBUG(message, ...)                                                         \
-  camille::logger::InternalLog("\033[36mDEBUG\033[0m", camille::logger::TrimPath(__FILE__), \
-                               __LINE__, message, ##__VA_ARGS__)
-#define CAMILLE_INFO(message, ...)                                                             \
-  camille::logger::InternalLog("INFO", camille::logger::TrimPath(__FILE__), __LINE__, message, \
-                               ##__VA_ARGS__)
-#define CAMILLE_WARNING(message, ...)                                                         \
-  camille::logger::InternalLog("\033[33mWARNING\033[0m", camille::logger::TrimPath(__FILE__), \
-                               __LINE__, message, ##__VA_ARGS__)
-#define CAMILLE_ERROR(message, ...)                                                         \
-  camille::logger::InternalLog("\033[31mERROR\033[0m", camille::logger::TrimPath(__FILE__), \
-                               __LINE__, message, ##__VA_ARGS__)
-#define CAMILLE_CRITICAL(message, ...)                                                         \
-  camille::logger::InternalLog("\033[35mCRITICAL\033[0m", camille::logger::TrimPath(__FILE__), \
-                               __LINE__, message, ##__VA_ARGS__)
+#define CAMILLE_LOG(level, label, message, ...)                                         \
+  do {                                                                                  \
+    if (camille::logger::Enabled(camille::logger::Level::level, kCamilleLogModule)) {   \
+      camille::logger::InternalLog(label, camille::logger::TrimPath(__FILE__), __LINE__, \
+                                   message, ##__VA_ARGS__);                              \
+    }                                                                                   \
+  } while (false)
+
+#define CAMILLE(message, ...) CAMILLE_LOG(kInfo, "CAMILLE", message, ##__VA_ARGS__)
+
+#if CAMILLE_ACTIVE_LEVEL <= CAMILLE_LEVEL_TRACE
+#define CAMILLE_TRACE(message, ...) \
+  CAMILLE_LOG(kTrace, "\033[32mTRACE\033[0m", message, ##__VA_ARGS__)
+#else
+#define CAMILLE_TRACE(message, ...) static_cast<void>(0)
+#endif
+
+#if CAMILLE_ACTIVE_LEVEL <= CAMILLE_LEVEL_DEBUG
+#define CAMILLE_DEBUG(message, ...) \
+  CAMILLE_LOG(kDebug, "\033[36mDEBUG\033[0m", message, ##__VA_ARGS__)
+#else
+#define CAMILLE_DEBUG(message, ...) static_cast<void>(0)
+#endif
+
+#if CAMILLE_ACTIVE_LEVEL <= CAMILLE_LEVEL_INFO
+#define CAMILLE_INFO(message, ...) CAMILLE_LOG(kInfo, "INFO", message, ##__VA_ARGS__)
+#else
+#define CAMILLE_INFO(message, ...) static_cast<void>(0)
+#endif
+
+#if CAMILLE_ACTIVE_LEVEL <= CAMILLE_LEVEL_WARNING
+#define CAMILLE_WARNING(message, ...) \
+  CAMILLE_LOG(kWarning, "\033[33mWARNING\033[0m", message, ##__VA_ARGS__)
+#else
+#define CAMILLE_WARNING(message, ...) static_cast<void>(0)
+#endif
+
+#if CAMILLE_ACTIVE_LEVEL <= CAMILLE_LEVEL_ERROR
+#define CAMILLE_ERROR(message, ...) \
+  CAMILLE_LOG(kError, "\033[31mERROR\033[0m", message, ##__VA_ARGS__)
+#else
+#define CAMILLE_ERROR(message, ...) static_cast<void>(0)
+#endif
+
+#if CAMILLE_ACTIVE_LEVEL <= CAMILLE_LEVEL_CRITICAL
+#define CAMILLE_CRITICAL(message, ...) \
+  CAMILLE_LOG(kCritical, "\033[35mCRITICAL\033[0m", message, ##__VA_ARGS__)
+#else
+#define CAMILLE_CRITICAL(message, ...) static_cast<void>(0)
+#endif
 
 };  // namespace logger
 };  // namespace camille
 
-#endif
\ No newline at end of file
+/**
+ * @brief Module of the CAMILLE_* calls around it, found by unqualified lookup: camille::parser,
+ * camille::network and camille::pool declare their own, everything else logs as kGeneral.
+ */
+inline constexpr camille::logger::Module kCamilleLogModule = camille::logger::Module::kGeneral;
+
+#endif
@@ -0,0 +1,369 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_MEMORY_H_
+#define CAMILLE_INCLUDE_CAMILLE_MEMORY_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Request scoped memory.
+ * @details Every io_context runs on its own thread, so a thread local ArenaPool is a per io_context
+ * pool. A session leases an arena for a batch of requests and gives it back once the responses are
+ * written, the arena is then reset (rewound to its inline buffer) for the next lease. Request,
+ * RequestView and Response allocate from the arena of the current ArenaScope.
+ */
+
+namespace camille {
+namespace memory {
+
+static constexpr std::size_t kArenaBufferSize = 16 * 1024;
+
+struct AllocationStats {
+  std::uint64_t heap_allocations{0};
+  std::uint64_t heap_deallocations{0};
+  std::uint64_t heap_bytes{0};
+  std::uint64_t arena_leases{0};
+  std::uint64_t arena_resets{0};
+};
+
+/**
+ * @brief Counts what goes through to the general heap, single writer (its thread) so the relaxed
+ * counters never bounce between cores.
+ */
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+      : upstream_(upstream) {}
+
+  void Collect(AllocationStats& stats) const {
+    stats.heap_allocations += allocations_.load(std::memory_order_relaxed);
+    stats.heap_deallocations += deallocations_.load(std::memory_order_relaxed);
+    stats.heap_bytes += bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return upstream_->allocate(bytes, alignment);
+  }
+  void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override {
+    deallocations_.fetch_add(1, std::memory_order_relaxed);
+    upstream_->deallocate(pointer, bytes, alignment);
+  }
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* upstream_;
+  std::atomic<std::uint64_t> allocations_{0};
+  std::atomic<std::uint64_t> deallocations_{0};
+  std::atomic<std::uint64_t> bytes_{0};
+};
+
+/**
+ * @brief Monotonic arena over an inline buffer, only requests larger than the buffer reach the
+ * upstream (counted) heap.
+ */
+class Arena {
+ public:
+  explicit Arena(std::pmr::memory_resource* upstream)
+      : resource_(buffer_.data(), buffer_.size(), upstream) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  [[nodiscard]] std::pmr::memory_resource* Resource() { return &resource_; }
+  void Reset() { resource_.release(); }
+
+ private:
+  alignas(std::max_align_t) std::array<std::byte, kArenaBufferSize> buffer_{};
+  std::pmr::monotonic_buffer_resource resource_;
+};
+
+/**
+ * @brief Free list of the thread that created it, which pushes and pops without a lock. Items given
+ * back from any other thread (a lease released off its io_context, sessions torn down at shutdown)
+ * go to a locked side list that the owner takes over once its own list runs dry.
+ * @tparam T
+ */
+template <typename T>
+class FreeList {
+ public:
+  /**
+   * @brief Owner only.
+   */
+  std::optional<T> Pop() {
+    if (local_.empty() && remote_size_.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard lock(mutex_);
+      local_.swap(remote_);
+      remote_size_.store(0, std::memory_order_relaxed);
+    }
+    if (local_.empty()) {
+      return std::nullopt;
+    }
+    T item = std::move(local_.back());
+    local_.pop_back();
+    return item;
+  }
+
+  void Push(T item) {
+    if (std::this_thread::get_id() == owner_) {
+      local_.push_back(std::move(item));
+      return;
+    }
+    std::lock_guard lock(mutex_);
+    remote_.push_back(std::move(item));
+    remote_size_.store(remote_.size(), std::memory_order_relaxed);
+  }
+
+ private:
+  std::thread::id owner_{std::this_thread::get_id()};
+  std::vector<T> local_;
+  std::mutex mutex_;
+  std::vector<T> remote_;
+  std::atomic<std::size_t> remote_size_{0};
+};
+
+class ArenaPool;
+
+/**
+ * @brief Move-only handle of a leased arena, resets and returns it on Release() or destruction.
+ */
+class ArenaLease {
+ public:
+  ArenaLease() = default;
+  ArenaLease(std::shared_ptr<ArenaPool> pool, std::unique_ptr<Arena> arena)
+      : pool_(std::move(pool)),
+        arena_(std::move(arena)) {}
+  ~ArenaLease() { Release(); }
+
+  ArenaLease(const ArenaLease&) = delete;
+  ArenaLease& operator=(const ArenaLease&) = delete;
+  ArenaLease(ArenaLease&& other) noexcept = default;
+  ArenaLease& operator=(ArenaLease&& other) noexcept {
+    if (this != &other) {
+      Release();
+      pool_ = std::move(other.pool_);
+      arena_ = std::move(other.arena_);
+    }
+    return *this;
+  }
+
+  explicit operator bool() const { return arena_ != nullptr; }
+  [[nodiscard]] std::pmr::memory_resource* Resource() const { return arena_->Resource(); }
+
+  inline void Release();
+
+ private:
+  std::shared_ptr<ArenaPool> pool_;
+  std::unique_ptr<Arena> arena_;
+};
+
+/**
+ * @brief Free list of arenas owned by one thread (one io_context).
+ * @details Held through a shared_ptr so leases that outlive the thread (sessions destroyed with
+ * their io_context at shutdown) still return to a live pool.
+ */
+class ArenaPool : public std::enable_shared_from_this<ArenaPool> {
+ public:
+  ArenaPool() = default;
+
+  /**
+   * @brief Owner thread only.
+   */
+  [[nodiscard]] ArenaLease Acquire() {
+    auto arena = free_.Pop();
+    if (!arena) {
+      arena = std::make_unique<Arena>(&upstream_);
+    }
+    leases_.fetch_add(1, std::memory_order_relaxed);
+    return {shared_from_this(), std::move(*arena)};
+  }
+
+  /**
+   * @brief Any thread, the upstream counters are atomic.
+   */
+  void Give(std::unique_ptr<Arena> arena) {
+    arena->Reset();
+    resets_.fetch_add(1, std::memory_order_relaxed);
+    free_.Push(std::move(arena));
+  }
+
+  void Collect(AllocationStats& stats) const {
+    upstream_.Collect(stats);
+    stats.arena_leases += leases_.load(std::memory_order_relaxed);
+    stats.arena_resets += resets_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  CountingResource upstream_;
+  FreeList<std::unique_ptr<Arena>> free_;
+  std::atomic<std::uint64_t> leases_{0};
+  std::atomic<std::uint64_t> resets_{0};
+};
+
+inline void ArenaLease::Release() {
+  if (arena_) {
+    pool_->Give(std::move(arena_));
+    pool_.reset();
+  }
+}
+
+/**
+ * @brief Every pool ever created, only touched when a thread creates its pool or on Stats().
+ */
+struct PoolRegistry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ArenaPool>> pools;
+};
+
+inline PoolRegistry& Registry() {
+  static PoolRegistry registry;
+  return registry;
+}
+
+inline ArenaPool& ThreadArenaPool() {
+  thread_local std::shared_ptr<ArenaPool> pool = []() {
+    auto created = std::make_shared<ArenaPool>();
+    auto& registry = Registry();
+    std::lock_guard lock(registry.mutex);
+    registry.pools.push_back(created);
+    return created;
+  }();
+  return *pool;
+}
+
+/**
+ * @brief Text buffers grown past this are freed instead of going back to the pool.
+ */
+static constexpr std::size_t kMaxPooledBuffer = 64 * 1024;
+
+class BufferPool;
+
+/**
+ * @brief Move-only handle of a leased text buffer, returns it (cleared, capacity kept) on Release()
+ * or destruction.
+ */
+class BufferLease {
+ public:
+  BufferLease() = default;
+  BufferLease(std::shared_ptr<BufferPool> pool, std::string buffer)
+      : pool_(std::move(pool)),
+        buffer_(std::move(buffer)) {}
+  ~BufferLease() { Release(); }
+
+  BufferLease(const BufferLease&) = delete;
+  BufferLease& operator=(const BufferLease&) = delete;
+  BufferLease(BufferLease&& other) noexcept = default;
+  BufferLease& operator=(BufferLease&& other) noexcept {
+    if (this != &other) {
+      Release();
+      pool_ = std::move(other.pool_);
+      buffer_ = std::move(other.buffer_);
+    }
+    return *this;
+  }
+
+  explicit operator bool() const { return pool_ != nullptr; }
+  [[nodiscard]] std::string& Buffer() { return buffer_; }
+  [[nodiscard]] const std::string& Buffer() const { return buffer_; }
+
+  inline void Release();
+
+ private:
+  std::shared_ptr<BufferPool> pool_;
+  std::string buffer_;
+};
+
+/**
+ * @brief Free list of text buffers owned by one thread (one io_context), a connection leases one
+ * for its serialized headers so a new connection starts with the capacity of a closed one.
+ */
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+ public:
+  BufferPool() = default;
+
+  /**
+   * @brief Owner thread only.
+   */
+  [[nodiscard]] BufferLease Acquire() {
+    return {shared_from_this(), free_.Pop().value_or(std::string{})};
+  }
+
+  /**
+   * @brief Any thread.
+   */
+  void Give(std::string buffer) {
+    if (buffer.capacity() > kMaxPooledBuffer) {
+      return;
+    }
+    buffer.clear();
+    free_.Push(std::move(buffer));
+  }
+
+ private:
+  FreeList<std::string> free_;
+};
+
+inline void BufferLease::Release() {
+  if (pool_) {
+    pool_->Give(std::move(buffer_));
+    buffer_ = {};
+    pool_.reset();
+  }
+}
+
+inline BufferPool& ThreadBufferPool() {
+  thread_local std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+  return *pool;
+}
+
+/**
+ * @brief Allocation counters summed over every thread, heap_* only moves when an arena overflows.
+ */
+inline AllocationStats Stats() {
+  AllocationStats stats;
+  auto& registry = Registry();
+  std::lock_guard lock(registry.mutex);
+  for (const auto& pool : registry.pools) {
+    pool->Collect(stats);
+  }
+  return stats;
+}
+
+inline thread_local std::pmr::memory_resource* current_resource = nullptr;
+
+/**
+ * @brief The arena of the innermost ArenaScope on this thread, the default resource outside one.
+ */
+inline std::pmr::memory_resource* CurrentResource() {
+  return current_resource != nullptr ? current_resource : std::pmr::get_default_resource();
+}
+
+class ArenaScope {
+ public:
+  explicit ArenaScope(std::pmr::memory_resource* resource)
+      : previous_(std::exchange(current_resource, resource)) {}
+  ~ArenaScope() { current_resource = previous_; }
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  std::pmr::memory_resource* previous_;
+};
+
+};  // namespace memory
+};  // namespace camille
+
+#endif
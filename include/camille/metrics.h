@@ -0,0 +1,398 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_METRICS_H_
+#define CAMILLE_INCLUDE_CAMILLE_METRICS_H_
+
+#include "benchmark.h"
+#include "error.h"
+#include "infra.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Metrics registry rendered in the Prometheus text exposition format.
+ * @details Every series owns a slot in a per-thread block, updates are a relaxed load and store on
+ * the calling thread's block (no shared cache line, no locked instruction) and the render sums the
+ * blocks. Gauges are sharded the same way, each thread holds its share of the up and down deltas.
+ */
+
+namespace camille {
+namespace metrics {
+
+static constexpr std::size_t kMaxSeries = 1024;
+static constexpr std::string_view kContentType = "text/plain; version=0.0.4; charset=utf-8";
+
+enum class Type : std::uint8_t { kCounter, kGauge, kHistogram };
+
+static constexpr std::string_view TypeToString(const Type type) {
+  switch (type) {
+    case Type::kCounter:
+      return "counter";
+    case Type::kGauge:
+      return "gauge";
+    case Type::kHistogram:
+      return "histogram";
+    default:
+      return "untyped";
+  }
+}
+
+/**
+ * @brief Upper bounds (ns) of the exported latency buckets, each one sums the benchmark.h buckets
+ * that end at or below it, so a bound is exact to the ~3% width of those buckets.
+ */
+static constexpr std::array<std::uint64_t, 17> kLatencyBounds{
+    50'000,        100'000,       250'000,       500'000,      1'000'000,   2'500'000,
+    5'000'000,     10'000'000,    25'000'000,    50'000'000,   100'000'000, 250'000'000,
+    500'000'000,   1'000'000'000, 2'500'000'000, 5'000'000'000, 10'000'000'000};
+
+struct alignas(64) ThreadSlots {
+  std::array<std::atomic<std::uint64_t>, kMaxSeries> values{};
+  /**
+   * @brief Set for the io_context threads, their per-thread series are exported under it.
+   */
+  std::optional<std::size_t> context;
+};
+
+class Registry {
+ public:
+  static Registry& Instance() {
+    static Registry registry;
+    return registry;
+  }
+
+  Registry(const Registry&) = delete;
+  Registry& operator=(const Registry&) = delete;
+
+  ThreadSlots& Slots() {
+    thread_local std::shared_ptr<ThreadSlots> slots = [this]() {
+      auto created = std::make_shared<ThreadSlots>();
+      std::lock_guard lock(mutex_);
+      threads_.push_back(created);
+      return created;
+    }();
+    return *slots;
+  }
+
+  /**
+   * @brief Labels the calling thread as io_context index (called by pool::ContextPool).
+   */
+  void SetContext(std::size_t index) {
+    auto& slots = Slots();
+    std::lock_guard lock(mutex_);
+    slots.context = index;
+  }
+
+  /**
+   * @brief Adds a series to the family name (created on first use), labels is the inside of the
+   * braces, e.g. method="GET".
+   * @return the slot of the series
+   */
+  std::size_t Add(std::string_view name,
+                  std::string_view help,
+                  Type type,
+                  std::string_view labels = {},
+                  bool per_context = false) {
+    if (type == Type::kHistogram) {
+      throw std::invalid_argument("Histogram series take their buckets from benchmark.h");
+    }
+    std::lock_guard lock(mutex_);
+    if (next_slot_ == kMaxSeries) {
+      throw std::length_error("Metrics registry is full");
+    }
+    Family* family = nullptr;
+    for (auto& candidate : families_) {
+      if (candidate.name == name) {
+        family = &candidate;
+        break;
+      }
+    }
+    if (family == nullptr) {
+      family = &families_.emplace_back(Family{std::string(name), std::string(help), type, {}});
+    } else if (family->type != type) {
+      throw std::invalid_argument("Metric registered twice with different types");
+    }
+    family->series.push_back({std::string(labels), next_slot_, per_context});
+    return next_slot_++;
+  }
+
+  /**
+   * @brief Sum of the slot across every thread, gauges are read as signed.
+   */
+  [[nodiscard]] std::uint64_t Value(std::size_t slot) {
+    std::lock_guard lock(mutex_);
+    return SumLocked(slot);
+  }
+
+  [[nodiscard]] std::string Render() {
+    std::string text;
+    auto out = std::back_inserter(text);
+    {
+      std::lock_guard lock(mutex_);
+      for (const auto& family : families_) {
+        std::format_to(out, "# HELP {} {}\n# TYPE {} {}\n", family.name, family.help, family.name,
+                       TypeToString(family.type));
+        for (const auto& series : family.series) {
+          if (series.per_context) {
+            RenderPerContext(text, family, series);
+            continue;
+          }
+          RenderSample(text, family.name, series.labels, family.type, SumLocked(series.slot));
+        }
+      }
+    }
+    RenderLatency(text);
+    return text;
+  }
+
+ private:
+  struct Series {
+    std::string labels;
+    std::size_t slot;
+    bool per_context;
+  };
+
+  struct Family {
+    std::string name;
+    std::string help;
+    Type type;
+    std::vector<Series> series;
+  };
+
+  Registry() = default;
+
+  std::uint64_t SumLocked(std::size_t slot) const {
+    std::uint64_t sum{0};
+    for (const auto& thread : threads_) {
+      sum += thread->values[slot].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  static void RenderSample(std::string& text,
+                           std::string_view name,
+                           std::string_view labels,
+                           Type type,
+                           std::uint64_t value) {
+    auto out = std::back_inserter(text);
+    if (labels.empty()) {
+      std::format_to(out, "{} ", name);
+    } else {
+      std::format_to(out, "{}{{{}}} ", name, labels);
+    }
+    if (type == Type::kGauge) {
+      std::format_to(out, "{}\n", static_cast<std::int64_t>(value));
+    } else {
+      std::format_to(out, "{}\n", value);
+    }
+  }
+
+  void RenderPerContext(std::string& text, const Family& family, const Series& series) const {
+    for (const auto& thread : threads_) {
+      if (!thread->context) {
+        continue;
+      }
+      auto labels = std::format("{}{}context=\"{}\"", series.labels,
+                                series.labels.empty() ? "" : ",", *thread->context);
+      RenderSample(text, family.name, labels, family.type,
+                   thread->values[series.slot].load(std::memory_order_relaxed));
+    }
+  }
+
+  /**
+   * @brief The phase histograms of benchmark.h, exported as a histogram family (seconds). The
+   * count is the sum of the buckets read, so +Inf and _count agree while threads keep recording.
+   */
+  static void RenderLatency(std::string& text) {
+    auto out = std::back_inserter(text);
+    std::format_to(out,
+                   "# HELP camille_phase_seconds Latency of the request phases.\n"
+                   "# TYPE camille_phase_seconds {}\n",
+                   TypeToString(Type::kHistogram));
+    for (std::size_t phase_index{0}; phase_index < benchmark::kPhaseCount; ++phase_index) {
+      auto phase = static_cast<benchmark::Phase>(phase_index);
+      auto merged = benchmark::Merge(phase);
+      auto name = benchmark::PhaseToString(phase);
+      std::uint64_t cumulative{0};
+      std::size_t index{0};
+      for (auto bound : kLatencyBounds) {
+        // the last bucket also holds everything past its range, it only counts under +Inf.
+        while (index + 1 < benchmark::kBuckets && benchmark::BucketValue(index + 1) <= bound + 1) {
+          cumulative += merged.buckets[index++];
+        }
+        std::format_to(out, "camille_phase_seconds_bucket{{phase=\"{}\",le=\"{}\"}} {}\n", name,
+                       Seconds(bound), cumulative);
+      }
+      for (; index < benchmark::kBuckets; ++index) {
+        cumulative += merged.buckets[index];
+      }
+      std::format_to(out, "camille_phase_seconds_bucket{{phase=\"{}\",le=\"+Inf\"}} {}\n", name,
+                     cumulative);
+      std::format_to(out, "camille_phase_seconds_sum{{phase=\"{}\"}} {}\n", name,
+                     Seconds(merged.sum));
+      std::format_to(out, "camille_phase_seconds_count{{phase=\"{}\"}} {}\n", name, cumulative);
+    }
+  }
+
+  static double Seconds(std::uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e9;
+  }
+
+  std::mutex mutex_;
+  std::size_t next_slot_{0};
+  std::vector<Family> families_;
+  std::vector<std::shared_ptr<ThreadSlots>> threads_;
+};
+
+/**
+ * @brief Handle of a counter series, cheap to copy.
+ */
+class Counter {
+ public:
+  Counter() = default;
+  explicit Counter(std::size_t slot)
+      : slot_(slot) {}
+
+  void Add(std::uint64_t value = 1) const {
+    auto& cell = Registry::Instance().Slots().values[slot_];
+    cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] std::uint64_t Value() const { return Registry::Instance().Value(slot_); }
+
+ private:
+  std::size_t slot_{0};
+};
+
+/**
+ * @brief Handle of a gauge series, each thread adds its own deltas (they wrap, the sum does not).
+ */
+class Gauge {
+ public:
+  Gauge() = default;
+  explicit Gauge(std::size_t slot)
+      : slot_(slot) {}
+
+  void Add(std::int64_t value = 1) const {
+    auto& cell = Registry::Instance().Slots().values[slot_];
+    cell.store(cell.load(std::memory_order_relaxed) + static_cast<std::uint64_t>(value),
+               std::memory_order_relaxed);
+  }
+  void Sub(std::int64_t value = 1) const { Add(-value); }
+
+  [[nodiscard]] std::int64_t Value() const {
+    return static_cast<std::int64_t>(Registry::Instance().Value(slot_));
+  }
+
+ private:
+  std::size_t slot_{0};
+};
+
+inline Counter AddCounter(std::string_view name,
+                          std::string_view help,
+                          std::string_view labels = {}) {
+  return Counter{Registry::Instance().Add(name, help, Type::kCounter, labels)};
+}
+
+inline Gauge AddGauge(std::string_view name, std::string_view help, std::string_view labels = {}) {
+  return Gauge{Registry::Instance().Add(name, help, Type::kGauge, labels)};
+}
+
+static constexpr std::size_t kMethodCount = static_cast<std::size_t>(infra::Methods::kUnknown) + 1;
+static constexpr std::size_t kErrorCount =
+    static_cast<std::size_t>(error::Errors::kGarbageRequest) + 1;
+static constexpr std::size_t kMaxStatus = 600;
+
+/**
+ * @brief The server's own series, registered on first use.
+ */
+class Builtins {
+ public:
+  static Builtins& Instance() {
+    static Builtins builtins;
+    return builtins;
+  }
+
+  void Request(infra::Methods method) const { requests_[static_cast<std::size_t>(method)].Add(); }
+
+  void Response(infra::StatusCodes status) {
+    auto code = static_cast<std::size_t>(status);
+    if (code >= kMaxStatus) {
+      return;
+    }
+    auto slot = responses_[code].load(std::memory_order_acquire);
+    if (slot < 0) {
+      std::lock_guard lock(mutex_);
+      slot = responses_[code].load(std::memory_order_relaxed);
+      if (slot < 0) {
+        slot = static_cast<std::int32_t>(Registry::Instance().Add(
+            "camille_responses_total", "Responses sent by status code.", Type::kCounter,
+            std::format("status=\"{}\"", code)));
+        responses_[code].store(slot, std::memory_order_release);
+      }
+    }
+    Counter{static_cast<std::size_t>(slot)}.Add();
+  }
+
+  void ParseError(error::Errors error) const {
+    auto index = static_cast<std::size_t>(error);
+    if (index < kErrorCount) {
+      parse_errors_[index].Add();
+    }
+  }
+
+  Gauge connections_active;
+  Counter connections_accepted;
+  Counter bytes_in;
+  Counter bytes_out;
+  /**
+   * @brief Socket reads and writes in flight, exported per io_context.
+   */
+  Gauge pending_operations;
+
+ private:
+  Builtins() {
+    auto& registry = Registry::Instance();
+    connections_active = AddGauge("camille_connections_active", "Open client connections.");
+    connections_accepted =
+        AddCounter("camille_connections_accepted_total", "Accepted client connections.");
+    bytes_in = AddCounter("camille_bytes_received_total", "Bytes read from clients.");
+    bytes_out = AddCounter("camille_bytes_sent_total", "Bytes written to clients.");
+    pending_operations = Gauge{registry.Add("camille_io_context_pending_operations",
+                                            "Socket operations in flight on each io_context.",
+                                            Type::kGauge, {}, true)};
+    for (std::size_t index{0}; index < kMethodCount; ++index) {
+      requests_[index] = AddCounter(
+          "camille_requests_total", "Parsed requests by method.",
+          std::format("method=\"{}\"", infra::MethodToString(static_cast<infra::Methods>(index))));
+    }
+    for (std::size_t index{0}; index < kErrorCount; ++index) {
+      parse_errors_[index] = AddCounter(
+          "camille_parse_errors_total", "Rejected requests by parser error.",
+          std::format("error=\"{}\"", error::ErrorToLabel(static_cast<error::Errors>(index))));
+    }
+    for (auto& slot : responses_) {
+      slot.store(-1, std::memory_order_relaxed);
+    }
+  }
+
+  std::array<Counter, kMethodCount> requests_;
+  std::array<Counter, kErrorCount> parse_errors_;
+  std::mutex mutex_;
+  std::array<std::atomic<std::int32_t>, kMaxStatus> responses_;
+};
+
+};  // namespace metrics
+};  // namespace camille
+
+#endif
@@ -6,120 +6,519 @@
 #include "camille/benchmark.h"
 #include "types.h"
 #include "logging.h"
+#include "connection_manager.h"
 #include "handler.h"
+#include "memory.h"
+#include "metrics.h"
+#include "pool.h"
+#include "router.h"
+#include "timer.h"
 
-#include "asio/read_until.hpp"
+#include "asio/as_tuple.hpp"
+#include "asio/awaitable.hpp"
+#include "asio/co_spawn.hpp"
+#include "asio/post.hpp"
 #include "asio/read.hpp"
+#include "asio/use_awaitable.hpp"
 #include "asio/write.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
 #include <cstddef>
+#include <exception>
+#include <expected>
 #include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <tuple>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#include <unistd.h>
 
 namespace camille {
 namespace network {
 
+static constexpr logger::Module kCamilleLogModule = logger::Module::kNetwork;
+
+static constexpr std::size_t kReadSize = 4 * 1024;
+/**
+ * @brief Requests answered per batch before the responses are written, the rest of the buffered
+ * pipeline waits for the write to complete. Each response takes up to 3 buffers, so a full batch
+ * still fits in a single writev (asio gathers at most 64 buffers per call).
+ */
+static constexpr std::size_t kMaxPipelineDepth = 16;
+
+/**
+ * @brief Deadlines of a connection, each phase is a single deadline from the moment it starts (a
+ * client trickling bytes does not extend it).
+ * @details read_header: first byte of a request (or the accept) until its header block is parsed.
+ * read_body: header block until the body is complete. write: a batch of responses. keep_alive: idle
+ * time between two requests.
+ */
+struct Timeouts {
+  std::chrono::steady_clock::duration read_header{std::chrono::seconds(10)};
+  std::chrono::steady_clock::duration read_body{std::chrono::seconds(30)};
+  std::chrono::steady_clock::duration write{std::chrono::seconds(30)};
+  std::chrono::steady_clock::duration keep_alive{std::chrono::seconds(60)};
+};
+
+/**
+ * @brief Status of a request the parser rejected, 431 for an oversized header block and 400 for
+ * everything else.
+ */
+static constexpr infra::StatusCodes ParseErrorStatus(const error::Errors error) {
+  return error == error::Errors::kHeaderLimit ? infra::StatusCodes::kRequestHeaderFieldsTooLarge
+                                              : infra::StatusCodes::kBadRequest;
+}
+
+enum class Phase : std::uint8_t { kNone, kReadHeader, kReadBody, kWrite, kKeepAlive };
+
+static constexpr std::string_view PhaseToString(const Phase phase) {
+  switch (phase) {
+    case Phase::kReadHeader:
+      return "read header";
+    case Phase::kReadBody:
+      return "read body";
+    case Phase::kWrite:
+      return "write";
+    case Phase::kKeepAlive:
+      return "keep-alive";
+    default:
+      return "none";
+  }
+}
+
 class Session : public std::enable_shared_from_this<Session> {
   /**
    * @todo to add ssl we need do_handshake(), pass it to start()
-   * @todo add timeout with async_wait.
    * @brief check out boost implementation for server.
    */
  public:
-  explicit Session(types::camille::CamilleShared<types::aio::AsioIOSocket> socket, bool state)
-      : socket_(std::move(socket)),
-        state_(state) {}
+  explicit Session(types::camille::CamilleShared<types::aio::AsioIOSocket> socket,
+                   types::camille::CamilleShared<const router::RouteTable> routes,
+                   bool state,
+                   const Timeouts& timeouts = {},
+                   pool::TaskPool* tasks = nullptr)
+      : state_(state),
+        timeouts_(timeouts),
+        routes_(std::move(routes)),
+        tasks_(tasks),
+        socket_(std::move(socket)),
+        timer_(&Session::OnTimeout, this),
+        wheel_(asio::use_service<timer::TimerWheel>(
+            static_cast<asio::io_context&>(socket_->get_executor().context()))) {
+    connections_.increment();
+    request_handler_.SetBodyRoute([this](const request::RequestView& head) {
+      return BodySink(head);
+    });
+  }
+  ~Session() { connections_.decrement(); }
+
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
 
-  void Start() { DoRead(); }
+  /**
+   * @brief Spawns the session loop on the io_context of the socket, the coroutine owns a reference
+   * to the session until it returns.
+   */
+  void Start() {
+    asio::co_spawn(
+        socket_->get_executor(), [self = shared_from_this()]() { return self->Loop(); },
+        [](const std::exception_ptr& exception) {
+          if (!exception) {
+            return;
+          }
+          try {
+            std::rethrow_exception(exception);
+          } catch (const std::exception& error) {
+            CAMILLE_ERROR("Session failed: {}", error.what());
+          }
+        });
+  }
 
   bool GetState() const { return state_; }
 
  private:
-  class ReadHandler {
-   public:
-    explicit ReadHandler(types::camille::CamilleShared<Session> ptr,
-                         handler::RequestHandler& request_handler)
-        : self(std::move(ptr)),
-          self_request_handler(request_handler) {}
-
-    void operator()(const std::error_code& error_code, size_t bytes) {
-      if (!error_code) {
-        asio::streambuf::const_buffers_type buffer = self->stream_buffer_.data();
-
-        std::string_view data(static_cast<const char*>(buffer.data()),
-                              static_cast<std::ptrdiff_t>(bytes));
-
-        // std::string data(
-        //     asio::buffers_begin(buffer),
-        //     std::next(asio::buffers_begin(buffer), static_cast<std::ptrdiff_t>(bytes)));
-
-        {
-          Benchmark here{"Parser Benchmark"};
-          auto request = self_request_handler.Parse(data);
-          request->PrintRequest();
+  enum class Step : std::uint8_t { kIdle, kAnswered, kAwait };
+
+  /**
+   * @brief Reads, answers every complete request already buffered (up to kMaxPipelineDepth) in
+   * order, writes all the responses with one gather write, and only reads again when the buffer
+   * holds no full request.
+   */
+  asio::awaitable<void> Loop() {
+    DoWait(Phase::kReadHeader);
+    bool open = co_await Read();
+    while (open) {
+      co_await Batch();
+      if (serializer_.Empty()) {
+        arena_.Release();
+        if (request_handler_.InBody()) {
+          DoWait(Phase::kReadBody);
+        } else {
+          DoWait(stream_buffer_.size() == 0 ? Phase::kKeepAlive : Phase::kReadHeader);
         }
+        open = co_await Read();
+        continue;
+      }
+      open = co_await Write();
+      if (open && close_) {
+        Close();
+        open = false;
+      }
+    }
+  }
+
+  /**
+   * @brief One batch of the pipeline. Requests and responses allocate from a leased arena, given
+   * back once the responses are written. Coroutine and offloaded routes suspend the batch until
+   * their response is back, it is queued behind the previous ones so responses keep the request
+   * order.
+   */
+  asio::awaitable<void> Batch() {
+    if (!arena_) {
+      arena_ = memory::ThreadArenaPool().Acquire();
+    }
+    size_t consumed{0};
+    while (serializer_.Count() < kMaxPipelineDepth && !close_) {
+      auto step = Next(consumed);
+      if (step == Step::kIdle) {
+        break;
+      }
+      if (step == Step::kAwait) {
+        DoWait(Phase::kNone);
+        auto response = co_await Await();
+        awaiting_.reset();
+        metrics::Builtins::Instance().Response(response.Status());
+        serializer_.Add(std::move(response), connection_, head_request_);
+      }
+    }
+    stream_buffer_.consume(consumed);
+  }
+
+  /**
+   * @brief Parses the next buffered request and answers it when its route is synchronous. The
+   * arena scope never spans a suspension, other sessions of the thread run in between.
+   * @param consumed - bytes of the batch parsed so far
+   */
+  Step Next(size_t& consumed) {
+    asio::streambuf::const_buffers_type buffer = stream_buffer_.data();
+    std::string_view data(static_cast<const char*>(buffer.data()), buffer.size());
+    if (consumed >= data.size()) {
+      return Step::kIdle;
+    }
+    memory::ArenaScope scope{arena_.Resource()};
+
+    auto parse_start = benchmark::Clock::now();
+    auto request = request_handler_.Feed(data.substr(consumed));
+    benchmark::Record(benchmark::Phase::kParse, benchmark::Clock::now() - parse_start);
+    if (!request) {
+      if (request.error() == error::Errors::kPartialMessage) {
+        // the decoded part of a chunked body is no longer needed in the buffer.
+        consumed += request_handler_.Release();
+        return Step::kIdle;
+      }
+      auto status = ParseErrorStatus(request.error());
+      metrics::Builtins::Instance().ParseError(request.error());
+      metrics::Builtins::Instance().Response(status);
+      serializer_.Add(response::Response{status}, response::Connection::kClose);
+      consumed = data.size();
+      close_ = true;
+      return Step::kAnswered;
+    }
+    if (state_) {
+      request->PrintRequest();
+    }
+
+    consumed += request_handler_.Consumed();
+    request_handler_.Reset();
+    close_ = !request->KeepAlive();
+    connection_ = response::ConnectionFor(!close_, request->Version());
+    head_request_ = request->MethodId() == infra::Methods::kHead;
+    metrics::Builtins::Instance().Request(request->MethodId());
+    auto route = Find(*request);
+    if (route && (*route)->Static() != nullptr) {
+      metrics::Builtins::Instance().Response((*route)->status_code);
+      serializer_.Add(*(*route)->Static(), connection_);
+      return Step::kAnswered;
+    }
+    if (route && ((*route)->IsAsync() ||
+                  ((*route)->execution == router::Execution::kOffload && tasks_ != nullptr))) {
+      awaiting_ = std::move(*request);
+      awaiting_route_ = *route;
+      return Step::kAwait;
+    }
+    auto response =
+        route ? router::RouteTable::Invoke(**route, *request) : response::Response{route.error()};
+    metrics::Builtins::Instance().Response(response.Status());
+    serializer_.Add(std::move(response), connection_, head_request_);
+    return Step::kAnswered;
+  }
+
+  /**
+   * @brief Sink of a chunked body, from the route of its head (nullptr keeps the body for the
+   * handler).
+   */
+  parser::Parser::BodySink BodySink(const request::RequestView& head) const {
+    auto request = head;
+    auto route = Find(request);
+    if (!route || !(*route)->body) {
+      return nullptr;
+    }
+    return (*route)->body(request);
+  }
+
+  std::expected<const router::Route*, infra::StatusCodes> Find(
+      request::RequestView& request) const {
+    if (!routes_) {
+      return std::unexpected(infra::StatusCodes::kNotFound);
+    }
+    return routes_->Find(request);
+  }
 
-        self->stream_buffer_.consume(bytes);
-        self->DoWrite(bytes);
-      } else if (error_code == asio::error::eof) {
-        CAMILLE_WARNING("Session ended");
+  /**
+   * @brief Response of the awaiting request, a handler that throws answers 500. Meanwhile the
+   * session neither reads nor writes, the request view and the rest of the pipeline stay in the
+   * untouched stream buffer.
+   */
+  asio::awaitable<response::Response> Await() {
+    const auto& route = *awaiting_route_;
+    try {
+      if (route.IsAsync()) {
+        co_return co_await router::RouteTable::InvokeAsync(route, *awaiting_);
       }
+      co_return co_await Offload(route, *awaiting_);
+    } catch (const std::exception& error) {
+      CAMILLE_ERROR("Handler failed: {}", error.what());
+    }
+    co_return response::Response{infra::StatusCodes::kInternalServerError};
+  }
+
+  /**
+   * @brief Runs a synchronous handler on the task pool, completes on the session's io_context (an
+   * exception of the handler is rethrown there).
+   */
+  asio::awaitable<response::Response> Offload(const router::Route& route,
+                                              const request::RequestView& request) {
+    auto executor = socket_->get_executor();
+    co_return co_await asio::async_initiate<const asio::use_awaitable_t<>,
+                                            void(std::exception_ptr, response::Response)>(
+        [this, executor, &route, &request](auto handler) {
+          tasks_->Submit([executor, &route, &request, handler = std::move(handler)]() mutable {
+            std::exception_ptr exception;
+            response::Response response;
+            try {
+              response = router::RouteTable::Invoke(route, request);
+            } catch (...) {
+              exception = std::current_exception();
+            }
+            asio::post(executor, [handler = std::move(handler), exception,
+                                  response = std::move(response)]() mutable {
+              std::move(handler)(exception, std::move(response));
+            });
+          });
+        },
+        asio::use_awaitable);
+  }
+
+  /**
+   * @return false when the session is over (closed, timed out or failed)
+   */
+  asio::awaitable<bool> Read() {
+    metrics::Builtins::Instance().pending_operations.Add();
+    auto [error_code, bytes] = co_await socket_->async_read_some(
+        stream_buffer_.prepare(kReadSize), asio::as_tuple(asio::use_awaitable));
+    metrics::Builtins::Instance().pending_operations.Sub();
+    if (!error_code) {
+      metrics::Builtins::Instance().bytes_in.Add(bytes);
+      stream_buffer_.commit(bytes);
+      co_return true;
+    }
+    if (error_code == asio::error::eof || error_code == asio::error::connection_reset) {
+      CAMILLE_WARNING("Session ended");
+    } else if (error_code != asio::error::operation_aborted) {
+      CAMILLE_ERROR("Unexpected Session Error: {}", error_code.message());
     }
+    co_return false;
+  }
 
-    types::camille::CamilleShared<Session> self;
-    handler::RequestHandler self_request_handler;
-  };
-
-  class WriteHandler {
-   public:
-    WriteHandler(types::camille::CamilleShared<Session> ptr,
-                 size_t consume,
-                 handler::ResponseHandler& response_handler)
-        : self(std::move(ptr)),
-          to_consume(consume),
-          self_response_handler(response_handler) {}
-
-    void operator()(const std::error_code& error_code, size_t) const {
-      if (!error_code) {
-        self->stream_buffer_.consume(to_consume);
-        self->DoRead();
-      } else if (error_code == asio::error::eof || error_code == asio::error::connection_reset ||
-                 error_code == asio::error::broken_pipe) {
-        CAMILLE_WARNING("Session ended");
-      } else {
-        CAMILLE_ERROR("Unexpected Session Error: {}", error_code.message());
+  /**
+   * @brief Writes the batch, then gives the arena back.
+   * @return false when the session is over
+   */
+  asio::awaitable<bool> Write() {
+    DoWait(Phase::kWrite);
+    write_start_ = benchmark::Clock::now();
+    metrics::Builtins::Instance().pending_operations.Add();
+    std::error_code error_code;
+    std::size_t bytes{0};
+    for (const auto& segment : serializer_.Segments()) {
+      auto [write_error, written] = co_await asio::async_write(
+          *socket_, segment.buffers, asio::as_tuple(asio::use_awaitable));
+      bytes += written;
+      error_code = write_error;
+      if (!error_code && segment.file != nullptr) {
+        auto [file_error, sent] = co_await SendFile(*segment.file);
+        bytes += sent;
+        error_code = file_error;
       }
+      if (error_code) {
+        break;
+      }
+    }
+    metrics::Builtins::Instance().pending_operations.Sub();
+    if (!error_code) {
+      metrics::Builtins::Instance().bytes_out.Add(bytes);
+      benchmark::Record(benchmark::Phase::kWrite, benchmark::Clock::now() - write_start_);
+      serializer_.Clear();
+      arena_.Release();
+      co_return true;
     }
+    if (error_code == asio::error::eof || error_code == asio::error::connection_reset ||
+        error_code == asio::error::broken_pipe) {
+      CAMILLE_WARNING("Session ended");
+    } else if (error_code != asio::error::operation_aborted) {
+      CAMILLE_ERROR("Unexpected Session Error: {}", error_code.message());
+    }
+    co_return false;
+  }
 
-    size_t to_consume;
-    types::camille::CamilleShared<Session> self;
-    handler::ResponseHandler self_response_handler;
-  };
+  /**
+   * @brief Sends a file body from its descriptor, the kernel copies the pages straight to the
+   * socket (sendfile) and the coroutine only suspends while the socket buffer is full.
+   * @return the error, eof when the file shrank under the response, and the bytes sent
+   */
+  asio::awaitable<std::tuple<std::error_code, std::size_t>> SendFile(
+      const response::FileBody& file) {
+    std::size_t sent{0};
+#ifdef __linux__
+    std::error_code error_code;
+    socket_->native_non_blocking(true, error_code);
+    if (error_code) {
+      co_return std::tuple{error_code, sent};
+    }
+    auto offset = static_cast<off_t>(file.offset);
+    while (sent < file.length) {
+      auto result = ::sendfile(socket_->native_handle(), file.fd, &offset, file.length - sent);
+      if (result > 0) {
+        sent += static_cast<std::size_t>(result);
+        continue;
+      }
+      if (result == 0) {
+        co_return std::tuple{std::error_code{asio::error::eof}, sent};
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        co_return std::tuple{std::error_code{errno, std::system_category()}, sent};
+      }
+      auto [wait_error] = co_await socket_->async_wait(types::aio::AsioIOSocket::wait_write,
+                                                       asio::as_tuple(asio::use_awaitable));
+      if (wait_error) {
+        co_return std::tuple{wait_error, sent};
+      }
+    }
+#else
+    std::array<char, kReadSize> chunk{};
+    while (sent < file.length) {
+      auto size = std::min<std::size_t>(chunk.size(), file.length - sent);
+      auto result = ::pread(file.fd, chunk.data(), size, static_cast<off_t>(file.offset + sent));
+      if (result <= 0) {
+        co_return std::tuple{result == 0 ? std::error_code{asio::error::eof}
+                                         : std::error_code{errno, std::system_category()},
+                             sent};
+      }
+      auto [write_error, written] =
+          co_await asio::async_write(*socket_, asio::buffer(chunk.data(), result),
+                                     asio::as_tuple(asio::use_awaitable));
+      sent += written;
+      if (write_error) {
+        co_return std::tuple{write_error, sent};
+      }
+    }
+#endif
+    co_return std::tuple{std::error_code{}, sent};
+  }
 
-  void DoRead() {
-    asio::async_read_until(*socket_, stream_buffer_, "\r\n\r\n",
-                           ReadHandler{shared_from_this(), request_handler_});
-    // asio::async_read(*socket_, stream_buffer_, ReadHandler{shared_from_this(),
-    // request_handler_});
+  void Close() {
+    timer_.Cancel();
+    phase_ = Phase::kNone;
+    std::error_code error_code;
+    socket_->shutdown(types::aio::AsioIOSocket::shutdown_both, error_code);
+    socket_->close(error_code);
   }
 
-  void DoWrite(std::size_t bytes_to_write) {
-    asio::async_write(*socket_, stream_buffer_,
-                      WriteHandler(shared_from_this(), bytes_to_write, response_handler_));
+  /**
+   * @brief Arms the deadline of phase on the io_context's timer wheel, a phase that is already
+   * running keeps its deadline.
+   * @param phase
+   */
+  void DoWait(Phase phase) {
+    if (phase == phase_ && phase != Phase::kWrite) {
+      return;
+    }
+    phase_ = phase;
+    switch (phase) {
+      case Phase::kReadHeader:
+        wheel_.Schedule(timer_, timeouts_.read_header);
+        break;
+      case Phase::kReadBody:
+        wheel_.Schedule(timer_, timeouts_.read_body);
+        break;
+      case Phase::kWrite:
+        wheel_.Schedule(timer_, timeouts_.write);
+        break;
+      case Phase::kKeepAlive:
+        wheel_.Schedule(timer_, timeouts_.keep_alive);
+        break;
+      default:
+        timer_.Cancel();
+        break;
+    }
   }
 
   /**
-   * @todo implement it with chorno for timeouts with condv.
+   * @brief Expiry closes the socket, the pending read or write completes with operation_aborted
+   * and releases the session.
    */
-  void DoWait();
+  static void OnTimeout(void* owner) {
+    auto* session = static_cast<Session*>(owner);
+    CAMILLE_WARNING("Session {} ({})", error::ErrorToString(error::NetworkError::kTimeout),
+                    PhaseToString(session->phase_));
+    session->Close();
+  }
 
   bool state_{false};
+  bool close_{false};
+  /**
+   * @brief Connection header of the response to the last parsed request.
+   */
+  response::Connection connection_{response::Connection::kPersistent};
+  bool head_request_{false};
+  ConnectionManager connections_;
+  Phase phase_{Phase::kNone};
+  Timeouts timeouts_;
+  benchmark::Clock::time_point write_start_{};
+  memory::ArenaLease arena_;
+  response::Serializer serializer_;
   handler::RequestHandler request_handler_;
-  handler::ResponseHandler response_handler_;
+  types::camille::CamilleShared<const router::RouteTable> routes_;
+  pool::TaskPool* tasks_{nullptr};
+  std::optional<request::RequestView> awaiting_;
+  const router::Route* awaiting_route_{nullptr};
   types::aio::AsioIOStreamBuffer stream_buffer_;
   types::camille::CamilleShared<types::aio::AsioIOSocket> socket_;
+  timer::TimerNode timer_;
+  timer::TimerWheel& wheel_;
 };
 
 };  // namespace network
 };  // namespace camille
 
-#endif
\ No newline at end of file
+#endif
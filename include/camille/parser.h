@@ -4,12 +4,22 @@
 #include "infra.h"
 #include "types.h"
 #include "concepts.h"
+#include "datastructures.h"
 #include "error.h"
+#include "logging.h"
+#include "simd.h"
 
 #include <cstddef>
 #include <cstdint>
 #include <array>
+#include <memory>
+#include <cstring>
+#include <algorithm>
 #include <expected>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
 #include <string_view>
 
 /**
@@ -26,12 +36,13 @@ length is correct.
  * size limits and other restrictions.
  * 2. finish the parser and the body consumption, add validation if it exceeds the size limits.
  * 3. keep a const http version that cross-validates it with the frontend.
- * 4. finish Transfer-Encoding & Content-Length.
  */
 
 namespace camille {
 namespace parser {
 
+static constexpr logger::Module kCamilleLogModule = logger::Module::kParser;
+
 enum class States : std::uint8_t {
   kReady,
   // kFileUpload,
@@ -46,13 +57,30 @@ enum class States : std::uint8_t {
   kHeaders,
   kBodyValidation,
   kBodyIdentify,
-  kBodyChunked,
+  kBodyChunked,  // chunk-size [ chunk-ext ] CRLF
+  kChunkData,
+  kChunkDataEnd,
+  kChunkTrailers,
   kComplete,
   kGarbage
 };
 
 static constexpr std::uint64_t kTableLimit = 256;
 static constexpr std::uint64_t kBodyLimit = 64 * 1024;
+static constexpr std::uint64_t kLineLimit = 8 * 1024;
+static constexpr std::uint64_t kHeaderBytesLimit = 32 * 1024;
+static constexpr std::uint64_t kHeaderCountLimit = 100;
+
+/**
+ * @brief Size caps of a single message, kBodyLimit applies to Content-Length and chunked bodies.
+ * The header caps cover the request line and the header block, and the trailers on their own.
+ */
+struct ParserLimits {
+  size_t max_chunk_size{kBodyLimit};
+  size_t max_body_size{kBodyLimit};
+  size_t max_header_bytes{kHeaderBytesLimit};
+  size_t max_header_count{kHeaderCountLimit};
+};
 
 static constexpr bool IsSpace(char token) { return token == ' ' || token == '\t'; }
 static constexpr bool IsDigit(char token) { return (token >= '0' && token <= '9'); }
@@ -76,18 +104,8 @@ static constexpr bool IsOWS(char token) {
 }
 static constexpr bool IsCR(char token) { return token == 0x0D; }
 static constexpr bool IsLF(char token) { return token == 0x0A; }
-static constexpr bool IsHeadersEnd(types::camille::CamilleStringViewIt& pos,
-                                   types::camille::CamilleStringViewIt end) {
-  if ((end - pos) >= 2 && IsCR(*pos) && IsLF(*(pos + 1))) {
-    pos += 2;
-    if ((end - pos) >= 2 && IsCR(*pos) && IsLF(*(pos + 1))) {
-      pos += 2;
-      return false;
-    }
-  }
-  return true;
-}
-static constexpr std::expected<size_t, bool> ValidateContentLength(std::string_view value) {
+static constexpr std::expected<size_t, bool> ValidateContentLength(std::string_view value,
+                                                                   size_t limit = kBodyLimit) {
   if (value.empty()) {
     return std::unexpected(false);
   }
@@ -103,12 +121,182 @@ static constexpr std::expected<size_t, bool> ValidateContentLength(std::string_v
     content_length = (content_length * 10) + (token - '0');
   }
 
-  if (content_length > kBodyLimit) {
+  if (content_length > limit) {
     return std::unexpected(false);
   }
   return content_length;
 }
 
+/**
+ * @brief Position of a parsed field, relative to the first byte of the message.
+ */
+struct Span {
+  size_t offset{0};
+  size_t length{0};
+};
+
+/**
+ * @brief Records the parsed fields as spans instead of views.
+ * @details The buffer handed to Parser::Feed may move between calls (asio::streambuf reallocates
+ * when it grows), so views are only built once the message is complete, by Apply().
+ */
+class Marks {
+ public:
+  void Rebase(std::string_view data) { data_ = data; }
+  /**
+   * @brief Base of the trailer spans, the parser copies the trailers out of the buffer because
+   * the body before them is released as it is decoded.
+   */
+  void RebaseTrailers(std::string_view data) { trailer_data_ = data; }
+  void Clear() {
+    host_ = {};
+    port_ = {};
+    path_ = {};
+    body_ = {};
+    method_ = {};
+    method_id_ = infra::Methods::kUnknown;
+    version_ = {};
+    headers_.clear();
+    index_.Clear();
+    trailers_.clear();
+    trailer_data_ = {};
+    in_trailers_ = false;
+    content_length_ = 0;
+    size_ = 0;
+  }
+
+  void SetHost(std::string_view host) {
+    if (!in_trailers_) {
+      host_ = ToSpan(host);
+    }
+  }
+  void SetPort(std::string_view port) {
+    if (!in_trailers_) {
+      port_ = ToSpan(port);
+    }
+  }
+  void SetPath(std::string_view path) { path_ = ToSpan(path); }
+  void SetBody(std::string_view body) { body_ = ToSpan(body); }
+  void SetMethod(std::string_view method) { SetMethod(infra::MethodEnum(method), method); }
+  void SetMethod(infra::Methods id, std::string_view method) {
+    method_id_ = id;
+    method_ = ToSpan(method);
+  }
+  void SetVersion(std::string_view version) { version_ = ToSpan(version); }
+  void SetSize(size_t size) { size_ = size; }
+
+  [[nodiscard]] size_t ContentLength() const { return content_length_; }
+  void SetContentLength(size_t content_length) { content_length_ = content_length; }
+
+  void AddHeader(std::string_view key, std::string_view value) {
+    AddHeader(infra::HeaderEnum(key), key, value);
+  }
+  void AddHeader(infra::HeaderId id, std::string_view key, std::string_view value) {
+    if (in_trailers_) {
+      trailers_.push_back({ToSpan(key, trailer_data_), ToSpan(value, trailer_data_), id});
+      return;
+    }
+    index_.Add(id, headers_.size());
+    headers_.push_back({ToSpan(key), ToSpan(value), id});
+  }
+  /**
+   * @brief Fields parsed after this go to the trailers, they never override the headers.
+   */
+  void BeginTrailers() { in_trailers_ = true; }
+  /**
+   * @brief Value of a known header, the first one when it is repeated (see HeaderCount()).
+   */
+  [[nodiscard]] std::optional<std::string_view> GetHeader(infra::HeaderId id) const {
+    auto position = index_.Find(id);
+    if (!position.has_value()) {
+      return std::nullopt;
+    }
+    return View(headers_[position.value()].value);
+  }
+  /**
+   * @brief How often a known header was sent, 2 stands for any repetition.
+   */
+  [[nodiscard]] std::uint8_t HeaderCount(infra::HeaderId id) const { return index_.Count(id); }
+  [[nodiscard]] std::optional<std::string_view> GetHeader(std::string_view header_key) const {
+    auto id = infra::HeaderEnum(header_key);
+    if (id != infra::HeaderId::kUnknown) {
+      return GetHeader(id);
+    }
+
+    for (const auto& field : headers_) {
+      if (infra::IEquals(header_key, View(field.key))) {
+        return View(field.value);
+      }
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * @brief Builds the caller's type from the recorded spans over the current buffer.
+   * @tparam T
+   * @param dtype
+   */
+  template <concepts::IsReqResType T>
+  void Apply(T& dtype) const {
+    if constexpr (requires { dtype.SetMethod(method_id_, View(method_)); }) {
+      dtype.SetMethod(method_id_, View(method_));
+    } else {
+      dtype.SetMethod(View(method_));
+    }
+    dtype.SetPath(View(path_));
+    dtype.SetVersion(View(version_));
+    for (const auto& field : headers_) {
+      if constexpr (requires { dtype.AddHeader(field.id, View(field.key), View(field.value)); }) {
+        dtype.AddHeader(field.id, View(field.key), View(field.value));
+      } else {
+        dtype.AddHeader(View(field.key), View(field.value));
+      }
+    }
+    dtype.SetHost(View(host_));
+    dtype.SetPort(View(port_));
+    dtype.SetContentLength(content_length_);
+    dtype.SetBody(View(body_));
+    dtype.SetSize(size_);
+    if constexpr (requires(std::string_view field) { dtype.AddTrailer(field, field); }) {
+      for (const auto& field : trailers_) {
+        dtype.AddTrailer(View(field.key, trailer_data_), View(field.value, trailer_data_));
+      }
+    }
+  }
+
+ private:
+  struct Field {
+    Span key;
+    Span value;
+    infra::HeaderId id{infra::HeaderId::kUnknown};
+  };
+
+  [[nodiscard]] Span ToSpan(std::string_view value) const { return ToSpan(value, data_); }
+  [[nodiscard]] static Span ToSpan(std::string_view value, std::string_view base) {
+    return {static_cast<size_t>(value.data() - base.data()), value.size()};
+  }
+  [[nodiscard]] std::string_view View(Span span) const { return View(span, data_); }
+  [[nodiscard]] static std::string_view View(Span span, std::string_view base) {
+    return base.substr(span.offset, span.length);
+  }
+
+  std::string_view data_;
+  std::string_view trailer_data_;
+  Span host_;
+  Span port_;
+  Span path_;
+  Span body_;
+  Span method_;
+  infra::Methods method_id_{infra::Methods::kUnknown};
+  Span version_;
+  types::camille::CamilleVector<Field> headers_;
+  datastructure::HeaderIndex index_;
+  types::camille::CamilleVector<Field> trailers_;
+  bool in_trailers_{false};
+  size_t content_length_{0};
+  size_t size_{0};
+};
+
 class Parser {
  public:
   /**
@@ -184,32 +372,112 @@ class Parser {
     std::string_view data;
   };
 
+ public:
+  /**
+   * @brief Receives decoded chunk data as soon as it is parsed, instead of the body.
+   */
+  using BodySink = std::function<void(std::string_view)>;
+  /**
+   * @brief Picks the sink of one chunked body once its head is parsed (see Head()), before the
+   * first chunk is decoded. nullptr falls back to SetBodySink(), or keeps the body for the
+   * completed message.
+   */
+  using HeadHook = std::function<BodySink(const Parser&)>;
+
  public:
   Parser() = default;
+  explicit Parser(ParserLimits limits)
+      : limits_(limits) {}
 
   explicit operator bool() const { return current_state_ == States::kComplete; }
 
-  void SetUsed() { used_ = true; }
   [[nodiscard]] bool IsDataEnd() const noexcept { return rocky_.begin == rocky_.end; }
   [[nodiscard]] std::uint8_t GetErrorCode() const noexcept {
     return static_cast<std::uint8_t>(error_);
   }
   [[nodiscard]] std::string_view GetErrorString() const { return error::ErrorToString(error_); }
+  /**
+   * @brief Bytes parsed so far, once complete it is the size of the message, anything after it
+   * belongs to the next (pipelined) message.
+   */
+  [[nodiscard]] size_t Consumed() const noexcept { return offset_; }
+  /**
+   * @brief The header block is complete and the parser waits for (more of) the body.
+   */
+  [[nodiscard]] bool InBody() const noexcept {
+    return current_state_ >= States::kBodyValidation && current_state_ < States::kComplete;
+  }
+
+  /**
+   * @brief Streams chunked bodies into sink, the completed message then carries an empty body.
+   * @param sink
+   */
+  void SetBodySink(BodySink sink) { body_sink_ = std::move(sink); }
+  /**
+   * @brief Called for every chunked message, the sink it returns only lasts for that message.
+   * @param hook
+   */
+  void SetHeadHook(HeadHook hook) { head_hook_ = std::move(hook); }
 
+  /**
+   * @brief The fields parsed so far, without a body. Only meant for the HeadHook, the views are
+   * valid until the next chunked message.
+   */
   template <concepts::IsReqResType T>
-  static bool ParseMethod(auto& pos, const It end, T& dtype) {
-    auto begin = pos;
-    while (pos != end && !IsSpace(*pos) && !IsLower(*pos)) {
-      if (IsControl(*pos)) {
-        return false;
-      }
-      ++pos;
+  [[nodiscard]] T Head() const {
+    T dtype;
+    marks_.Apply(dtype);
+    return dtype;
+  }
+
+  /**
+   * @brief Bytes at the front of the buffer the caller can drop now. Once the head of a chunked
+   * message is copied out of the buffer, everything parsed so far is released: the decoded chunks
+   * went to the sink or the body buffer. The offsets are rebased, the next Feed() starts right
+   * after the released bytes.
+   */
+  [[nodiscard]] size_t Release() {
+    if (!detached_ || current_state_ == States::kComplete || current_state_ == States::kGarbage) {
+      return 0;
     }
-    std::string_view method(begin, pos - begin);
-    if (infra::MethodEnum(method) == infra::Methods::kUnknown) {
+    auto released = offset_;
+    offset_ = 0;
+    scanned_ = scanned_ > released ? scanned_ - released : 0;
+    line_end_ = 0;
+    released_ += released;
+    return released;
+  }
+
+  /**
+   * @brief Recycles the parser for the next message on the same connection (keep-alive).
+   */
+  void Reset() {
+    rocky_ = {};
+    chunked_ = false;
+    detached_ = false;
+    message_sink_ = nullptr;
+    chunk_remaining_ = 0;
+    body_size_ = 0;
+    offset_ = 0;
+    released_ = 0;
+    scanned_ = 0;
+    line_end_ = 0;
+    block_start_ = 0;
+    fields_ = 0;
+    marks_.Clear();
+    current_state_ = States::kReady;
+    error_ = error::Errors::kGeneralError;
+  }
+
+  template <concepts::IsReqResType T>
+  static bool ParseMethod(auto& pos, const It end, T& dtype) {
+    std::string_view line(std::to_address(pos), static_cast<size_t>(end - pos));
+    auto match = infra::kMethodTable.Classify(line);
+    if (match.method == infra::Methods::kUnknown) {
       return false;
     }
-    dtype.SetMethod(method);
+    dtype.SetMethod(match.method, line.substr(0, match.length));
+    pos += static_cast<std::ptrdiff_t>(match.length);
     return true;
   }
 
@@ -221,7 +489,11 @@ class Parser {
     }
     ++pos;
 
-    while (pos != end && !IsSpace(*pos)) {
+    while (pos != end) {
+      pos += static_cast<std::ptrdiff_t>(simd::ScanUri(std::to_address(pos), end - pos));
+      if (pos == end || IsSpace(*pos)) {
+        break;
+      }
       if (IsControl(*pos)) {
         return false;
       }
@@ -295,68 +567,74 @@ class Parser {
       ++pos;
     }
     std::string_view host(value.begin(), pos - value.begin());
-    ++pos;
+    if (pos != value.end()) {
+      ++pos;
+    }
     std::string_view port(pos, value.end() - pos);
     dtype.SetHost(host);
     dtype.SetPort(port);
   }
 
+  /**
+   * @brief Parses a single "key: value\r\n" line, end is the position right after its LF.
+   */
   template <concepts::IsReqResType T>
-  static bool ParseHeaders(auto& pos, const It end, T& dtype) {
-    It begin{};
-    bool can_consume_more{true};
-
-    while (can_consume_more && pos < end) {
-      begin = pos;
-      while (pos != end && *pos != ':') {
-        if (HeaderKeyTraits::IsValid(*pos)) {
-          ++pos;
-        } else {
-          return false;
-        }
+  static bool ParseHeader(auto& pos, const It end, T& dtype) {
+    It begin = pos;
+    while (pos != end) {
+      pos += static_cast<std::ptrdiff_t>(simd::ScanHeaderKey(std::to_address(pos), end - pos));
+      if (pos == end || *pos == ':') {
+        break;
       }
-
-      if (pos == begin || pos == end) {
+      if (HeaderKeyTraits::IsValid(*pos)) {
+        ++pos;
+      } else {
         return false;
       }
+    }
+
+    if (pos == begin || pos == end) {
+      return false;
+    }
 
-      std::string_view current_key(begin, pos - begin);
+    std::string_view current_key(begin, pos - begin);
 
+    ++pos;
+    if (pos != end && IsSpace(*pos)) {
       ++pos;
-      if (pos != end && IsSpace(*pos)) {
+    } else {
+      return false;
+    }
+
+    begin = pos;
+    while (pos != end) {
+      pos += static_cast<std::ptrdiff_t>(simd::ScanHeaderValue(std::to_address(pos), end - pos));
+      if (pos == end || IsCR(*pos)) {
+        break;
+      }
+      if (HeaderValueTraits::IsValid(*pos)) {
         ++pos;
       } else {
         return false;
       }
+    }
 
-      begin = pos;
-      while (pos != end && !IsCR(*pos)) {
-        if (HeaderValueTraits::IsValid(*pos)) {
-          ++pos;
-        } else {
-          return false;
-        }
-      }
-
-      auto owsit = pos;
-      while (owsit > begin && IsSpace(*(owsit - 1))) {
-        --owsit;
-      }
-
-      std::string_view current_value(begin, owsit - begin);
-      dtype.AddHeader(current_key, current_value);
-      if (current_key.size() == 4 && (current_key[0] | 0x20) == 'h' &&
-          (current_key[1] | 0x20) == 'o' && (current_key[2] | 0x20) == 's' &&
-          (current_key[3] | 0x20) == 't') {
-        ParseHost(current_value, dtype);
-      }
+    auto owsit = pos;
+    while (owsit > begin && IsSpace(*(owsit - 1))) {
+      --owsit;
+    }
 
-      begin = pos;
+    std::string_view current_value(begin, owsit - begin);
+    auto id = infra::HeaderEnum(current_key);
+    dtype.AddHeader(id, current_key, current_value);
+    if (id == infra::HeaderId::kHost) {
+      ParseHost(current_value, dtype);
+    }
 
-      if (!IsHeadersEnd(pos, end)) {
-        can_consume_more = false;
-      }
+    if ((end - pos) != 2 || !IsLF(*(pos + 1))) {
+      return false;
     }
+    pos += 2;
     return true;
   }
 
@@ -383,40 +661,134 @@ class Parser {
     return true;
   }
 
-  template <concepts::IsReqResType T>
-  static bool ParseBodyChunked(auto& pos, It end, T& dtype, std::string_view body_value) {
+  /**
+   * @brief Parses "chunk-size [ chunk-ext ] CRLF", end is the position right after its LF.
+   * @param pos
+   * @param end
+   * @param chunk_size
+   */
+  static bool ParseChunkSize(auto& pos, const It end, size_t& chunk_size) {
+    chunk_size = 0;
+    auto begin = pos;
+    while (pos != end && IsHexDigit(*pos)) {
+      if (chunk_size > (std::numeric_limits<size_t>::max() >> 4)) {
+        return false;
+      }
+      auto digit = IsDigit(*pos) ? *pos - '0' : (*pos | 0x20) - 'a' + 10;
+      chunk_size = (chunk_size << 4) | static_cast<size_t>(digit);
+      ++pos;
+    }
+    if (pos == begin || !ParseChunkExtensions(pos, end)) {
+      return false;
+    }
+    if ((end - pos) != 2 || !IsCR(*pos) || !IsLF(*(pos + 1))) {
+      return false;
+    }
+    pos += 2;
+    return true;
+  }
+
+  /**
+   * @brief Validates *( BWS ";" BWS ext-name [ BWS "=" BWS ( token / quoted-string ) ] ), the
+   * extensions carry nothing Camille understands so they are skipped (RFC 9112 7.1.1).
+   */
+  static bool ParseChunkExtensions(auto& pos, const It end) {
+    auto skip_ws = [&pos, end]() {
+      while (pos != end && IsSpace(*pos)) {
+        ++pos;
+      }
+    };
+    auto skip_token = [&pos, end]() {
+      auto begin = pos;
+      while (pos != end && HeaderKeyTraits::IsValid(*pos)) {
+        ++pos;
+      }
+      return pos != begin;
+    };
+
+    skip_ws();
+    while (pos != end && *pos == ';') {
+      ++pos;
+      skip_ws();
+      if (!skip_token()) {
+        return false;
+      }
+      skip_ws();
+      if (pos != end && *pos == '=') {
+        ++pos;
+        skip_ws();
+        if (pos != end && *pos == '"') {
+          ++pos;
+          while (pos != end && *pos != '"') {
+            if (*pos == '\\' && (pos + 1) != end) {
+              ++pos;
+            }
+            if (!HeaderValueTraits::IsValid(*pos)) {
+              return false;
+            }
+            ++pos;
+          }
+          if (pos == end) {
+            return false;
+          }
+          ++pos;
+        } else if (!skip_token()) {
+          return false;
+        }
+        skip_ws();
+      }
+    }
     return true;
   }
 
+  /**
+   * @brief One-shot parse, data has to hold the whole message.
+   * @tparam T
+   * @param data
+   */
   template <concepts::IsReqResType T>
   [[nodiscard]] std::expected<T, error::Errors> Parse(std::string_view data) {
     if (data.empty()) {
       error_ = error::Errors::kBadRequest;
       return std::unexpected(error_);
     }
+    return Feed<T>(data);
+  }
 
-    T dtype;
-    rocky_.begin = data.cbegin();
+  /**
+   * @brief Streaming parse, continues exactly where the previous call stopped.
+   * @details data has to start at the first byte of the message (the whole unconsumed buffer), or
+   * right after the bytes given back by Release(), it may have grown or moved since the previous
+   * call. Returns kPartialMessage until the message is complete, Reset() has to be called before
+   * feeding the next one.
+   * @tparam T
+   * @param data
+   */
+  template <concepts::IsReqResType T>
+  [[nodiscard]] std::expected<T, error::Errors> Feed(std::string_view data) {
+    if (current_state_ == States::kComplete || data.size() < offset_) {
+      error_ = error::Errors::kStaleParser;
+      return std::unexpected(error_);
+    }
+
+    rocky_.begin = data.cbegin() + static_cast<std::ptrdiff_t>(offset_);
     rocky_.end = data.cend();
     rocky_.data = data;
-    total_consumed_ = data.size();
+    if (!detached_) {
+      marks_.Rebase(data);
+    }
 
     while (current_state_ != States::kComplete && current_state_ != States::kGarbage) {
-      if (IsDataEnd()) {
-        return std::unexpected(error::Errors::kPartialMessage);
-      }
-
       switch (current_state_) {
         case States::kReady:
-          if (used_) {
-            error_ = error::Errors::kStaleParser;
-            current_state_ = States::kGarbage;
-          }
           current_state_ = States::kMethod;
           break;
 
         case States::kMethod:
-          if (!ParseMethod(rocky_.begin, rocky_.end, dtype)) {
+          if (!LineAvailable()) {
+            return Suspend();
+          }
+          if (!ParseMethod(rocky_.begin, rocky_.end, marks_)) {
             error_ = error::Errors::kBadMethod;
             current_state_ = States::kGarbage;
           } else {
@@ -444,7 +816,7 @@ class Parser {
           break;
 
         case States::kUri:
-          if (!ParseUri(rocky_.begin, rocky_.end, dtype)) {
+          if (!ParseUri(rocky_.begin, rocky_.end, marks_)) {
             error_ = error::Errors::kBadUri;
             current_state_ = States::kGarbage;
           } else {
@@ -463,7 +835,7 @@ class Parser {
           break;
 
         case States::kVersion:
-          if (!ParseVersion(rocky_.begin, rocky_.end, dtype)) {
+          if (!ParseVersion(rocky_.begin, rocky_.end, marks_)) {
             error_ = error::Errors::kBadVersion;
             current_state_ = States::kGarbage;
           } else {
@@ -476,100 +848,309 @@ class Parser {
             ++rocky_.begin;
             current_state_ = States::kHeaders;
           } else {
-            error_ = error::Errors::kPartialMessage;
+            error_ = error::Errors::kBadRequest;
             current_state_ = States::kGarbage;
           }
           break;
 
         case States::kHeaders: {
-          if (ParseHeaders(rocky_.begin, rocky_.end, dtype)) {
-            if (!dtype.GetHeader(infra::headers::kHost).has_value()) {
+          if (!LineAvailable()) {
+            return Suspend();
+          }
+          auto line_end = rocky_.data.cbegin() + static_cast<std::ptrdiff_t>(line_end_);
+          if ((line_end - rocky_.begin) == 2 && IsCR(*rocky_.begin)) {
+            rocky_.begin = line_end;
+            if (marks_.HeaderCount(infra::HeaderId::kHost) != 1) {
               error_ = error::Errors::kBadRequest;
               current_state_ = States::kGarbage;
               break;
             }
-            auto cl_header = dtype.GetHeader(infra::headers::kContentLength);
-            if (!cl_header.has_value()) {
-              current_state_ = States::kComplete;
-              dtype.SetSize(total_consumed_);
-              SetUsed();
-              return dtype;
+            // a repeated framing header is ambiguous (request smuggling), it is never ignored.
+            auto content_lengths = marks_.HeaderCount(infra::HeaderId::kContentLength);
+            auto encodings = marks_.HeaderCount(infra::HeaderId::kTransferEncoding);
+            if (content_lengths > 1 || encodings > 1) {
+              error_ = content_lengths > 1 ? error::Errors::kBadContentLength
+                                          : error::Errors::kBadRequest;
+              current_state_ = States::kGarbage;
+              break;
+            }
+            if (content_lengths == 0 && encodings == 0) {
+              return Complete<T>();
             }
             current_state_ = States::kBodyValidation;
-          } else {
+          } else if (!ParseHeader(rocky_.begin, line_end, marks_)) {
             error_ = error::Errors::kBadRequest;
             current_state_ = States::kGarbage;
+          } else {
+            CountField();
           }
         } break;
 
         case States::kBodyValidation: {
-          auto cl_header = dtype.GetHeader(infra::headers::kContentLength);
-          auto te_header = dtype.GetHeader(infra::headers::kTransferEncoding);
+          auto cl_header = marks_.GetHeader(infra::HeaderId::kContentLength);
+          auto te_header = marks_.GetHeader(infra::HeaderId::kTransferEncoding);
           if (cl_header.has_value() && te_header.has_value()) {
             error_ = error::Errors::kBadRequest;
             current_state_ = States::kGarbage;
           } else if (cl_header.has_value()) {
-            auto content_length = ValidateContentLength(cl_header.value());
+            auto content_length =
+                ValidateContentLength(cl_header.value(), limits_.max_body_size);
             if (!content_length) {
               error_ = error::Errors::kBadContentLength;
               current_state_ = States::kGarbage;
+              break;
             }
-            dtype.SetContentLength(content_length.value());
+            marks_.SetContentLength(content_length.value());
             current_state_ = States::kBodyIdentify;
-            break;
-          } else if (te_header.has_value()) {
+          } else if (te_header.has_value() && infra::IEquals(te_header.value(), "chunked")) {
+            chunked_ = true;
+            Detach();
             current_state_ = States::kBodyChunked;
-
+          } else {
             error_ = error::Errors::kBadRequest;
             current_state_ = States::kGarbage;
           }
         } break;
 
         case States::kBodyIdentify: {
-          size_t expected_length = dtype.ContentLength();
-          if (ParseBodyIdentify(rocky_.begin, rocky_.end, dtype, expected_length)) {
-            current_state_ = States::kComplete;
-            dtype.SetSize(total_consumed_);
-            SetUsed();
-            return dtype;
+          size_t expected_length = marks_.ContentLength();
+          if (!ParseBodyIdentify(rocky_.begin, rocky_.end, marks_, expected_length)) {
+            return Suspend();
           }
+          return Complete<T>();
         } break;
 
         case States::kBodyChunked: {
-          // if (ParseBodyChunked(rocky_.begin, rocky_.end, dtype, expected_length) && IsDataEnd())
-          // {
-          //   current_state_ = States::kComplete;
-          //   dtype.SetSize(total_consumed_);
-          //   SetUsed();
-          //   return dtype;
-          // }
-          error_ = error::Errors::kBadBody;
-          current_state_ = States::kGarbage;
+          if (!LineAvailable()) {
+            return Suspend();
+          }
+          auto line_end = rocky_.data.cbegin() + static_cast<std::ptrdiff_t>(line_end_);
+          size_t chunk_size{0};
+          if (!ParseChunkSize(rocky_.begin, line_end, chunk_size)) {
+            error_ = error::Errors::kBadBody;
+            current_state_ = States::kGarbage;
+          } else if (chunk_size > limits_.max_chunk_size ||
+                     chunk_size > limits_.max_body_size - body_size_) {
+            error_ = error::Errors::kBodyLimit;
+            current_state_ = States::kGarbage;
+          } else if (chunk_size == 0) {
+            marks_.BeginTrailers();
+            block_start_ = released_ + Offset();
+            fields_ = 0;
+            current_state_ = States::kChunkTrailers;
+          } else {
+            chunk_remaining_ = chunk_size;
+            body_size_ += chunk_size;
+            current_state_ = States::kChunkData;
+          }
         } break;
 
-        case States::kComplete:
-          SetUsed();
-          // if (!IsDataEnd()) {
-          //   return std::unexpected(error::Errors::kStaleParser);
-          // }
-          dtype.SetSize(total_consumed_);
-          return dtype;
+        case States::kChunkData: {
+          auto available = static_cast<size_t>(rocky_.end - rocky_.begin);
+          auto take = std::min(available, chunk_remaining_);
+          if (take != 0) {
+            ConsumeChunk(rocky_.data.substr(Offset(), take));
+            rocky_.begin += static_cast<std::ptrdiff_t>(take);
+            chunk_remaining_ -= take;
+          }
+          if (chunk_remaining_ != 0) {
+            return Suspend();
+          }
+          current_state_ = States::kChunkDataEnd;
+        } break;
 
-        case States::kGarbage:
-          return std::unexpected(error_);
+        case States::kChunkDataEnd:
+          if ((rocky_.end - rocky_.begin) < 2) {
+            return Suspend();
+          }
+          if (IsCR(*rocky_.begin) && IsLF(*(rocky_.begin + 1))) {
+            rocky_.begin += 2;
+            current_state_ = States::kBodyChunked;
+          } else {
+            error_ = error::Errors::kBadBody;
+            current_state_ = States::kGarbage;
+          }
           break;
 
+        case States::kChunkTrailers: {
+          if (!LineAvailable()) {
+            return Suspend();
+          }
+          auto line_end = rocky_.data.cbegin() + static_cast<std::ptrdiff_t>(line_end_);
+          if ((line_end - rocky_.begin) == 2 && IsCR(*rocky_.begin)) {
+            rocky_.begin = line_end;
+            return Complete<T>();
+          }
+          // the trailer outlives the buffer, its line is copied before it is parsed.
+          auto line_offset = static_cast<std::ptrdiff_t>(trailer_buffer_.size());
+          trailer_buffer_.append(rocky_.begin, line_end);
+          rocky_.begin = line_end;
+          marks_.RebaseTrailers(trailer_buffer_);
+          std::string_view trailers = trailer_buffer_;
+          auto trailer = trailers.cbegin() + line_offset;
+          if (!ParseHeader(trailer, trailers.cend(), marks_)) {
+            error_ = error::Errors::kBadHeader;
+            current_state_ = States::kGarbage;
+          } else {
+            CountField();
+          }
+        } break;
+
         default:
           return std::unexpected(error::Errors::kGeneralError);
       }
     }
+    offset_ = Offset();
     return std::unexpected(error_);
   }
 
  private:
+  [[nodiscard]] size_t Offset() const noexcept {
+    return static_cast<size_t>(rocky_.begin - rocky_.data.cbegin());
+  }
+
+  /**
+   * @brief Looks for the LF ending the current line, resuming the scan where the previous call
+   * gave up so a slowly arriving line is never scanned twice. Lines of the header block (or the
+   * trailers) also count against max_header_bytes, a block that outgrows it is garbage even when
+   * it never ends.
+   */
+  [[nodiscard]] bool LineAvailable() {
+    size_t begin = Offset();
+    size_t from = std::max(scanned_, begin);
+    const auto* found = static_cast<const char*>(
+        std::memchr(rocky_.data.data() + from, '\n', rocky_.data.size() - from));
+    if (found == nullptr) {
+      scanned_ = rocky_.data.size();
+      if (scanned_ - begin > kLineLimit) {
+        error_ = error::Errors::kSizeLimit;
+        current_state_ = States::kGarbage;
+      } else if (InHeaderBlock() && BlockSize(scanned_) > limits_.max_header_bytes) {
+        error_ = error::Errors::kHeaderLimit;
+        current_state_ = States::kGarbage;
+      }
+      return false;
+    }
+    line_end_ = static_cast<size_t>(found - rocky_.data.data()) + 1;
+    scanned_ = line_end_;
+    if (InHeaderBlock() && BlockSize(line_end_) > limits_.max_header_bytes) {
+      error_ = error::Errors::kHeaderLimit;
+      current_state_ = States::kGarbage;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief The current line belongs to the request line, the headers or the trailers (a chunk
+   * size line does not).
+   */
+  [[nodiscard]] bool InHeaderBlock() const noexcept {
+    return current_state_ != States::kBodyChunked;
+  }
+
+  /**
+   * @brief Bytes of the current header block up to end (an offset in the buffer).
+   */
+  [[nodiscard]] size_t BlockSize(size_t end) const noexcept {
+    return released_ + end - block_start_;
+  }
+
+  /**
+   * @brief One more header (or trailer) field, past max_header_count the message is garbage.
+   */
+  void CountField() {
+    if (++fields_ > limits_.max_header_count) {
+      error_ = error::Errors::kHeaderLimit;
+      current_state_ = States::kGarbage;
+    }
+  }
+
+  /**
+   * @brief Saves the position of the current state and asks for more data.
+   */
+  [[nodiscard]] std::unexpected<error::Errors> Suspend() {
+    offset_ = Offset();
+    if (current_state_ == States::kGarbage) {
+      return std::unexpected(error_);
+    }
+    return std::unexpected(error::Errors::kPartialMessage);
+  }
+
+  template <concepts::IsReqResType T>
+  [[nodiscard]] T Complete() {
+    current_state_ = States::kComplete;
+    offset_ = Offset();
+    marks_.SetSize(released_ + offset_);
+    T dtype;
+    marks_.Apply(dtype);
+    if (chunked_) {
+      dtype.SetContentLength(body_size_);
+      dtype.SetBody(Sink() != nullptr ? std::string_view{} : std::string_view{body_buffer_});
+    }
+    return dtype;
+  }
+
+  /**
+   * @brief Copies the head of a chunked message out of the buffer, so the chunks can be released
+   * as they are decoded. The copies (head, body, trailers) stay valid until the next chunked
+   * message.
+   */
+  void Detach() {
+    head_.assign(rocky_.data.substr(0, Offset()));
+    marks_.Rebase(head_);
+    body_buffer_.clear();
+    trailer_buffer_.clear();
+    detached_ = true;
+    if (head_hook_) {
+      message_sink_ = head_hook_(*this);
+    }
+  }
+
+  [[nodiscard]] const BodySink* Sink() const {
+    if (message_sink_) {
+      return &message_sink_;
+    }
+    return body_sink_ ? &body_sink_ : nullptr;
+  }
+
+  /**
+   * @brief Hands decoded data to the sink, or appends it to the body of the message.
+   */
+  void ConsumeChunk(std::string_view data) {
+    if (const auto* sink = Sink()) {
+      (*sink)(data);
+      return;
+    }
+    body_buffer_.append(data);
+  }
+
   Rocky rocky_;
-  bool used_{false};
-  size_t total_consumed_{0};
+  Marks marks_;
+  ParserLimits limits_;
+  BodySink body_sink_;
+  HeadHook head_hook_;
+  BodySink message_sink_;
+  bool chunked_{false};
+  bool detached_{false};
+  size_t chunk_remaining_{0};
+  size_t body_size_{0};
+  std::string head_;
+  std::string body_buffer_;
+  std::string trailer_buffer_;
+  size_t offset_{0};
+  /**
+   * @brief Bytes of the message the caller dropped (Release()), offsets are relative to them.
+   */
+  size_t released_{0};
+  size_t scanned_{0};
+  size_t line_end_{0};
+  /**
+   * @brief Position of the header block being parsed in the message (0, or the first trailer)
+   * and its fields.
+   */
+  size_t block_start_{0};
+  size_t fields_{0};
   States current_state_{States::kReady};
   error::Errors error_{error::Errors::kGeneralError};
 };
@@ -1,30 +1,56 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_POOL_H_
 #define CAMILLE_INCLUDE_CAMILLE_POOL_H_
 
+#include "affinity.h"
+#include "backend.h"
 #include "types.h"
 #include "concepts.h"
+#include "datastructures.h"
+#include "date.h"
 #include "logging.h"
+#include "memory.h"
+#include "metrics.h"
+#include "timer.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <thread>
 
 namespace camille {
 namespace pool {
 
+static constexpr logger::Module kCamilleLogModule = logger::Module::kPool;
+
 class Pool {
  public:
   virtual ~Pool() = default;
 };
 
+/**
+ * @brief One io_context per thread, each with its own timer::TimerWheel for connection timeouts,
+ * the first one also refreshes the date::Cache.
+ * @throws std::runtime_error when built with CAMILLE_IO_URING and the kernel has no io_uring.
+ */
 class ContextPool : public Pool {
  public:
   explicit ContextPool(
       concepts::UnsignedIntegral auto pool_size = std::thread::hardware_concurrency())
       : pool_size_(pool_size) {
+    if (backend::kCompiled == backend::Kind::kIoUring && !backend::IoUringSupported()) {
+      CAMILLE_CRITICAL("Built for io_uring but the kernel does not support it, rebuild with "
+                       "CAMILLE_IO_URING=OFF");
+      throw std::runtime_error("io_uring is not supported by the kernel");
+    }
     for (size_t i{0}; i < pool_size_; ++i) {
       auto ctx = std::make_shared<types::aio::AsioIOContext>();
       auto work_guard = std::make_shared<asio::executor_work_guard<types::aio::AsioExecutorType>>(
           asio::make_work_guard(*ctx));
+      asio::use_service<timer::TimerWheel>(*ctx);
       io_contexts_.emplace_back(ctx);
       work_guards_.emplace_back(work_guard);
     }
@@ -36,12 +62,32 @@ class ContextPool : public Pool {
       CAMILLE_CRITICAL("Error when trying to run context pool");
       throw std::runtime_error("Error when trying to run context pool");
     }
-    for (const auto& ctx : io_contexts_) {
-      threads_.emplace_back([ctx]() { ctx->run(); });
+    CAMILLE("I/O backend: {}", backend::KindToString(backend::kCompiled));
+    // one process-wide Date header, refreshed by the first io_context.
+    asio::use_service<date::Updater>(*io_contexts_.front()).Start();
+    auto plan = affinity::Plan(affinity_, io_contexts_.size());
+    for (size_t index{0}; index < io_contexts_.size(); ++index) {
+      const auto& ctx = io_contexts_[index];
+      asio::use_service<timer::TimerWheel>(*ctx).Start();
+      threads_.emplace_back([ctx, index, cpu = plan[index]]() {
+        if (cpu >= 0 && !affinity::PinCurrentThread(cpu)) {
+          CAMILLE_ERROR("Could not pin io_context {} to cpu {}", index, cpu);
+        }
+        // First touch after pinning, the per-thread state is allocated on the local NUMA node.
+        metrics::Registry::Instance().SetContext(index);
+        memory::ThreadArenaPool();
+        benchmark::Recorder::Instance().ThreadHistograms();
+        ctx->run();
+      });
       CAMILLE("BOOTING WORKER");
     }
   }
 
+  /**
+   * @brief Thread placement, takes effect on Run().
+   */
+  void SetAffinity(const affinity::Options& options) { affinity_ = options; }
+
   void Wait() {
     /**
      * @brief Blocks the main thread, runs "before" the log "listening at" is executed
@@ -65,8 +111,13 @@ class ContextPool : public Pool {
     return *io_contexts_[index];
   }
 
+  types::aio::AsioIOContext& GetIOContext(std::size_t index) { return *io_contexts_[index]; }
+
+  [[nodiscard]] std::size_t Size() const { return io_contexts_.size(); }
+
  private:
   unsigned pool_size_;
+  affinity::Options affinity_;
   std::atomic<bool> is_running_{false};
   std::atomic<size_t> next_io_context_{0};
   types::aio::SharedAsioIoContextVector io_contexts_;
@@ -74,6 +125,150 @@ class ContextPool : public Pool {
   types::camille::CamilleVector<std::jthread> threads_;
 };
 
+/**
+ * @brief Work-stealing pool for the handlers that should not run on an io_context thread.
+ * @details Each worker owns a Chase-Lev deque, tasks submitted from a worker go to its own deque
+ * and tasks from any other thread (the io_contexts) to a shared injection queue. An idle worker
+ * pops its deque, then the injection queue, then steals from the others before it sleeps.
+ */
+class TaskPool : public Pool {
+ public:
+  using Task = std::move_only_function<void()>;
+
+  explicit TaskPool(concepts::UnsignedIntegral auto pool_size = std::thread::hardware_concurrency())
+      : workers_(pool_size == 0 ? 1 : pool_size) {
+    for (auto& worker : workers_) {
+      worker = std::make_unique<Worker>();
+    }
+    for (size_t index{0}; index < workers_.size(); ++index) {
+      threads_.emplace_back([this, index](std::stop_token token) { Loop(index, token); });
+    }
+  }
+  ~TaskPool() { Stop(); }
+
+  TaskPool(const TaskPool&) = delete;
+  TaskPool& operator=(const TaskPool&) = delete;
+
+  void Submit(Task task) {
+    auto* pending = new Task(std::move(task));
+    if (current_pool_ == this) {
+      workers_[current_worker_]->deque.Push(pending);
+    } else {
+      std::lock_guard lock(injection_mutex_);
+      injection_.push_back(pending);
+    }
+    epoch_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+      std::lock_guard lock(mutex_);
+      condition_.notify_one();
+    }
+  }
+
+  /**
+   * @brief Joins the workers, tasks still queued are dropped.
+   */
+  void Stop() {
+    for (auto& thread : threads_) {
+      thread.request_stop();
+    }
+    {
+      std::lock_guard lock(mutex_);
+      condition_.notify_all();
+    }
+    threads_.clear();
+    for (auto& worker : workers_) {
+      while (auto task = worker->deque.Pop()) {
+        delete *task;
+      }
+    }
+    for (auto* task : injection_) {
+      delete task;
+    }
+    injection_.clear();
+  }
+
+  [[nodiscard]] std::size_t Size() const { return workers_.size(); }
+
+ private:
+  struct Worker {
+    datastructure::WorkStealingDeque<Task*> deque;
+  };
+
+  void Loop(size_t index, const std::stop_token& token) {
+    current_pool_ = this;
+    current_worker_ = index;
+    size_t idle{0};
+    while (!token.stop_requested()) {
+      auto epoch = epoch_.load();
+      if (auto* task = Next(index)) {
+        idle = 0;
+        Run(task);
+        continue;
+      }
+      // a lost steal race means another worker made progress, retry a few times before parking.
+      if (++idle < kSpinRounds) {
+        std::this_thread::yield();
+        continue;
+      }
+      idle = 0;
+      std::unique_lock lock(mutex_);
+      sleeping_.fetch_add(1);
+      condition_.wait(lock, [this, &token, epoch]() {
+        return token.stop_requested() || epoch_.load() != epoch;
+      });
+      sleeping_.fetch_sub(1);
+    }
+  }
+
+  Task* Next(size_t index) {
+    if (auto task = workers_[index]->deque.Pop()) {
+      return *task;
+    }
+    {
+      std::lock_guard lock(injection_mutex_);
+      if (!injection_.empty()) {
+        auto* task = injection_.front();
+        injection_.pop_front();
+        return task;
+      }
+    }
+    for (size_t offset{1}; offset < workers_.size(); ++offset) {
+      if (auto task = workers_[(index + offset) % workers_.size()]->deque.Steal()) {
+        return *task;
+      }
+    }
+    return nullptr;
+  }
+
+  static void Run(Task* task) {
+    std::unique_ptr<Task> owned{task};
+    try {
+      (*owned)();
+    } catch (const std::exception& exception) {
+      CAMILLE_ERROR("Task failed: {}", exception.what());
+    }
+  }
+
+  static constexpr size_t kSpinRounds = 64;
+
+  inline static thread_local TaskPool* current_pool_{nullptr};
+  inline static thread_local size_t current_worker_{0};
+
+  types::camille::CamilleVector<std::unique_ptr<Worker>> workers_;
+  std::mutex injection_mutex_;
+  std::deque<Task*> injection_;
+  /**
+   * @brief Bumped by every submit, sequentially consistent with sleeping_ so a submit either sees a
+   * sleeper to wake or the sleeper sees a new epoch. A worker parks on the epoch of its last empty
+   * scan, its own deque is drained by then and only the owner pushes there.
+   */
+  std::atomic<std::uint64_t> epoch_{0};
+  std::atomic<size_t> sleeping_{0};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  types::camille::CamilleVector<std::jthread> threads_;
+};
+
 };  // namespace pool
 };  // namespace camille
 
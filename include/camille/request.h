@@ -1,64 +1,103 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_REQUEST_H_
 #define CAMILLE_INCLUDE_CAMILLE_REQUEST_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <optional>
 
+#include "infra.h"
+#include "memory.h"
 #include "types.h"
+#include "datastructures.h"
 #include "logging.h"
 
 namespace camille {
 namespace request {
 
+/**
+ * @brief Owning request, its strings and headers allocate from the given resource (by default the
+ * arena of the current memory::ArenaScope). Copies fall back to the default resource.
+ */
 class Request {
  public:
-  Request() = default;
+  Request() : Request(memory::CurrentResource()) {}
+  explicit Request(std::pmr::memory_resource* resource)
+      : host_(resource),
+        port_(resource),
+        path_(resource),
+        body_(resource),
+        method_(resource),
+        version_(resource),
+        headers_(resource),
+        trailers_(resource) {}
 
   [[nodiscard]] std::string_view Host() const { return host_; }
-  void SetHost(std::string_view host) { host_ = std::string(host); }
+  void SetHost(std::string_view host) { host_ = host; }
 
   [[nodiscard]] std::string_view Port() const { return port_; }
-  void SetPort(std::string_view port) { port_ = std::string(port); }
+  void SetPort(std::string_view port) { port_ = port; }
 
   [[nodiscard]] std::string_view Path() const { return path_; }
-  void SetPath(std::string_view path) { path_ = std::string(path); }
+  void SetPath(std::string_view path) { path_ = path; }
 
   [[nodiscard]] std::string_view Body() const { return body_; }
-  void SetBody(std::string_view body) { body_ = std::string(body); }
+  void SetBody(std::string_view body) { body_ = body; }
 
   [[nodiscard]] std::string_view Method() const { return method_; }
-  void SetMethod(std::string_view method) { method_ = std::string(method); }
+  void SetMethod(std::string_view method) { method_ = method; }
 
   [[nodiscard]] std::string_view Version() const { return version_; }
-  void SetVersion(std::string_view version) { version_ = std::string(version); }
+  void SetVersion(std::string_view version) { version_ = version; }
 
   [[nodiscard]] size_t ContentLength() const { return content_length_; }
   void SetContentLength(size_t content_length) { content_length_ = content_length; }
 
   [[nodiscard]] const types::camille::CamilleHeaders& Headers() const { return headers_; }
   void AddHeader(std::string_view key, std::string_view value) {
-    headers_.emplace_back(std::string(key), std::string(value));
+    AddHeader(infra::HeaderEnum(key), key, value);
   }
   /**
-   * @brief Get the Header object (checks for duplicates and emptiness)
+   * @brief AddHeader() for a name that is already classified.
+   */
+  void AddHeader(infra::HeaderId id, std::string_view key, std::string_view value) {
+    index_.Add(id, headers_.size());
+    headers_.emplace_back(key, value);
+  }
+  /**
+   * @brief Get the Header object, the first value of a repeated header (see HeaderCount()). The
+   * name is case-insensitive and a known name is looked up in O(1).
    * @param header_key
    * @return std::optional<std::string_view>
    */
   [[nodiscard]] std::optional<std::string_view> GetHeader(std::string_view header_key) const {
-    int dup{0};
-    std::string_view header_value{};
+    auto id = infra::HeaderEnum(header_key);
+    if (id != infra::HeaderId::kUnknown) {
+      return GetHeader(id);
+    }
 
     for (const auto& [key, value] : headers_) {
-      if (header_key == key) {
-        header_value = std::string_view(value);
-        ++dup;
+      if (infra::IEquals(header_key, key)) {
+        return std::string_view(value);
       }
     }
-
-    if (dup == 1) {
-      return header_value;
-    }
     return std::nullopt;
   }
+  [[nodiscard]] std::optional<std::string_view> GetHeader(infra::HeaderId id) const {
+    auto position = index_.Find(id);
+    if (!position.has_value()) {
+      return std::nullopt;
+    }
+    return std::string_view(headers_[position.value()].second);
+  }
+  /**
+   * @brief How often a known header was sent, 2 stands for any repetition.
+   */
+  [[nodiscard]] std::uint8_t HeaderCount(infra::HeaderId id) const { return index_.Count(id); }
+
+  [[nodiscard]] const types::camille::CamilleHeaders& Trailers() const { return trailers_; }
+  void AddTrailer(std::string_view key, std::string_view value) {
+    trailers_.emplace_back(key, value);
+  }
 
   [[nodiscard]] bool Auth() const { return has_auth_; }
   void SetAuth(bool auth) { has_auth_ = auth; }
@@ -67,35 +106,209 @@ class Request {
   void SetSize(size_t size) { request_size_ = size; }
   void AddSize(size_t size) { request_size_ += size; }
 
+  /**
+   * @brief One debug record for the whole request.
+   */
   void PrintRequest() const {
-    CAMILLE_DEBUG("Method: {}", method_);
-    CAMILLE_DEBUG("Uri: {}", path_);
-    CAMILLE_DEBUG("Version: {}", version_);
-    CAMILLE_DEBUG("Host: {}", host_);
-    CAMILLE_DEBUG("Port: {}", port_);
-    for (const auto& [key, value] : headers_) {
-      CAMILLE_DEBUG("Header Key: {}", key);
-      CAMILLE_DEBUG("Header Value: {}", value);
-    }
-    CAMILLE_DEBUG("Size: {}", request_size_);
-    CAMILLE_DEBUG("Content-Length: {}", content_length_);
-    CAMILLE_DEBUG("Body: {}", body_);
+    CAMILLE_DEBUG("{} {} HTTP/{} | Host: {}:{} | Headers: {} | Size: {} | Content-Length: {} | "
+                  "Body: {}",
+                  method_, path_, version_, host_, port_, headers_, request_size_, content_length_,
+                  body_);
   }
 
  private:
-  std::string host_;
-  std::string port_;
-  std::string path_;
-  std::string body_;
-  std::string method_;
-  std::string version_;
-  size_t content_length_;
+  types::camille::CamilleString host_;
+  types::camille::CamilleString port_;
+  types::camille::CamilleString path_;
+  types::camille::CamilleString body_;
+  types::camille::CamilleString method_;
+  types::camille::CamilleString version_;
+  size_t content_length_{0};
   types::camille::CamilleHeaders headers_;
+  datastructure::HeaderIndex index_;
+  types::camille::CamilleHeaders trailers_;
 
   bool has_auth_{false};
   size_t request_size_{0};
 };
 
+/**
+ * @brief Non-owning request, every field is a view into the buffer that was parsed.
+ * @details Valid only while the parsed buffer is alive and unconsumed (for a session, until
+ * stream_buffer_.consume() is called on the request bytes), use ToOwned() to keep it longer. The
+ * header vectors allocate from the given resource (by default the current arena).
+ */
+class RequestView {
+ public:
+  RequestView() : RequestView(memory::CurrentResource()) {}
+  explicit RequestView(std::pmr::memory_resource* resource)
+      : headers_(resource),
+        trailers_(resource) {}
+
+  [[nodiscard]] std::string_view Host() const { return host_; }
+  void SetHost(std::string_view host) { host_ = host; }
+
+  [[nodiscard]] std::string_view Port() const { return port_; }
+  void SetPort(std::string_view port) { port_ = port; }
+
+  [[nodiscard]] std::string_view Path() const { return path_; }
+  void SetPath(std::string_view path) { path_ = path; }
+
+  [[nodiscard]] std::string_view Body() const { return body_; }
+  void SetBody(std::string_view body) { body_ = body; }
+
+  [[nodiscard]] std::string_view Method() const { return method_; }
+  /**
+   * @brief The method as classified by the parser, kUnknown for a method outside
+   * infra::kMethodNames.
+   */
+  [[nodiscard]] infra::Methods MethodId() const { return method_id_; }
+  void SetMethod(std::string_view method) { SetMethod(infra::MethodEnum(method), method); }
+  void SetMethod(infra::Methods id, std::string_view method) {
+    method_id_ = id;
+    method_ = method;
+  }
+
+  [[nodiscard]] std::string_view Version() const { return version_; }
+  void SetVersion(std::string_view version) { version_ = version; }
+
+  [[nodiscard]] size_t ContentLength() const { return content_length_; }
+  void SetContentLength(size_t content_length) { content_length_ = content_length; }
+
+  [[nodiscard]] const types::camille::CamilleViewHeaders& Headers() const { return headers_; }
+  void AddHeader(std::string_view key, std::string_view value) {
+    AddHeader(infra::HeaderEnum(key), key, value);
+  }
+  /**
+   * @brief AddHeader() for a name that is already classified (the parser tags the names as it
+   * reads them).
+   */
+  void AddHeader(infra::HeaderId id, std::string_view key, std::string_view value) {
+    index_.Add(id, headers_.size());
+    headers_.emplace_back(key, value);
+  }
+  /**
+   * @brief Get the Header object, the first value of a repeated header (see HeaderCount()). The
+   * name is case-insensitive and a known name is looked up in O(1).
+   * @param header_key
+   * @return std::optional<std::string_view>
+   */
+  [[nodiscard]] std::optional<std::string_view> GetHeader(std::string_view header_key) const {
+    auto id = infra::HeaderEnum(header_key);
+    if (id != infra::HeaderId::kUnknown) {
+      return GetHeader(id);
+    }
+
+    for (const auto& [key, value] : headers_) {
+      if (infra::IEquals(header_key, key)) {
+        return value;
+      }
+    }
+    return std::nullopt;
+  }
+  [[nodiscard]] std::optional<std::string_view> GetHeader(infra::HeaderId id) const {
+    auto position = index_.Find(id);
+    if (!position.has_value()) {
+      return std::nullopt;
+    }
+    return headers_[position.value()].second;
+  }
+  /**
+   * @brief How often a known header was sent, 2 stands for any repetition.
+   */
+  [[nodiscard]] std::uint8_t HeaderCount(infra::HeaderId id) const { return index_.Count(id); }
+
+  [[nodiscard]] const types::camille::CamilleViewHeaders& Trailers() const { return trailers_; }
+  void AddTrailer(std::string_view key, std::string_view value) {
+    trailers_.emplace_back(key, value);
+  }
+
+  /**
+   * @brief Path captures of the matched route ("{id}", "*path"), views into Path().
+   */
+  [[nodiscard]] const datastructure::PathParams& Params() const { return params_; }
+  [[nodiscard]] std::optional<std::string_view> Param(std::string_view name) const {
+    return params_.Get(name);
+  }
+  void SetParams(const datastructure::PathParams& params) { params_ = params; }
+
+  [[nodiscard]] size_t Size() const { return request_size_; }
+  void SetSize(size_t size) { request_size_ = size; }
+  void AddSize(size_t size) { request_size_ += size; }
+
+  /**
+   * @brief Persistent connection check, HTTP/1.1 stays open unless "Connection: close" and HTTP/1.0
+   * closes unless "Connection: keep-alive". Repeated Connection headers are one list.
+   */
+  [[nodiscard]] bool KeepAlive() const {
+    auto has_token = [this](std::string_view token) {
+      if (HeaderCount(infra::HeaderId::kConnection) < 2) {
+        auto connection = GetHeader(infra::HeaderId::kConnection);
+        return connection.has_value() && infra::HasToken(connection.value(), token);
+      }
+      return std::ranges::any_of(headers_, [token](const auto& field) {
+        return infra::IEquals(field.first, infra::headers::kConnection) &&
+               infra::HasToken(field.second, token);
+      });
+    };
+    if (version_ == "1.0") {
+      return has_token("keep-alive");
+    }
+    return !has_token("close");
+  }
+
+  /**
+   * @brief Copies every field into an owning Request, the only path in which the view copies.
+   * @param resource - the default resource, so the copy outlives the request arena.
+   * @return request::Request
+   */
+  [[nodiscard]] Request ToOwned(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const {
+    Request request{resource};
+    request.SetHost(host_);
+    request.SetPort(port_);
+    request.SetPath(path_);
+    request.SetBody(body_);
+    request.SetMethod(method_);
+    request.SetVersion(version_);
+    request.SetContentLength(content_length_);
+    for (const auto& [key, value] : headers_) {
+      request.AddHeader(key, value);
+    }
+    for (const auto& [key, value] : trailers_) {
+      request.AddTrailer(key, value);
+    }
+    request.SetSize(request_size_);
+    return request;
+  }
+
+  /**
+   * @brief One debug record for the whole request.
+   */
+  void PrintRequest() const {
+    CAMILLE_DEBUG("{} {} HTTP/{} | Host: {}:{} | Headers: {} | Size: {} | Content-Length: {} | "
+                  "Body: {}",
+                  method_, path_, version_, host_, port_, headers_, request_size_, content_length_,
+                  body_);
+  }
+
+ private:
+  std::string_view host_;
+  std::string_view port_;
+  std::string_view path_;
+  std::string_view body_;
+  std::string_view method_;
+  infra::Methods method_id_{infra::Methods::kUnknown};
+  std::string_view version_;
+  size_t content_length_{0};
+  types::camille::CamilleViewHeaders headers_;
+  datastructure::HeaderIndex index_;
+  types::camille::CamilleViewHeaders trailers_;
+  datastructure::PathParams params_;
+
+  size_t request_size_{0};
+};
+
 };  // namespace request
 };  // namespace camille
 
@@ -1,40 +1,104 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_RESPONSE_H_
 #define CAMILLE_INCLUDE_CAMILLE_RESPONSE_H_
 
+#include "date.h"
+#include "infra.h"
+#include "memory.h"
 #include "types.h"
 #include "logging.h"
 
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
 namespace camille {
 namespace response {
 
+/**
+ * @brief Body sent straight from a file descriptor (sendfile), owner keeps the descriptor open
+ * until the response is written.
+ */
+struct FileBody {
+  int fd{-1};
+  std::uint64_t offset{0};
+  std::uint64_t length{0};
+  std::shared_ptr<const void> owner;
+};
+
+/**
+ * @brief Response builder, its strings and headers allocate from the given resource (by default the
+ * arena of the current memory::ArenaScope, which lives until the response is written). Moves keep
+ * the resource, copies fall back to the default resource.
+ */
 class Response {
  public:
-  Response() = default;
+  Response() : Response(memory::CurrentResource()) {}
+  explicit Response(std::pmr::memory_resource* resource)
+      : host_(resource),
+        port_(resource),
+        path_(resource),
+        body_(resource),
+        method_(resource),
+        version_(resource),
+        headers_(resource) {}
+
+  explicit Response(infra::StatusCodes status_code)
+      : Response(memory::CurrentResource()) {
+    SetStatus(status_code);
+  }
+
+  [[nodiscard]] infra::StatusCodes Status() const { return status_code_; }
+  void SetStatus(infra::StatusCodes status_code) {
+    status_code_ = status_code;
+    has_status_ = true;
+  }
+  /**
+   * @brief False until a status is given, the route's default status then applies.
+   */
+  [[nodiscard]] bool HasStatus() const { return has_status_; }
 
   [[nodiscard]] std::string_view Host() const { return host_; }
-  void SetHost(std::string_view host) { host_ = std::string(host); }
+  void SetHost(std::string_view host) { host_ = host; }
 
   [[nodiscard]] std::string_view Port() const { return port_; }
-  void SetPort(std::string_view port) { port_ = std::string(port); }
+  void SetPort(std::string_view port) { port_ = port; }
 
   [[nodiscard]] std::string_view Method() const { return method_; }
-  void SetMethod(std::string_view method) { method_ = std::string(method); }
+  void SetMethod(std::string_view method) { method_ = method; }
 
   [[nodiscard]] std::string_view Path() const { return path_; }
-  void SetPath(std::string_view path) { path_ = std::string(path); }
+  void SetPath(std::string_view path) { path_ = path; }
 
   [[nodiscard]] std::string_view Body() const { return body_; }
-  void SetBody(std::string_view body) { body_ = std::string(body); }
+  void SetBody(std::string_view body) { body_ = body; }
 
   [[nodiscard]] std::string_view Version() const { return version_; }
-  void SetVersion(std::string_view version) { version_ = std::string(version); }
+  void SetVersion(std::string_view version) { version_ = version; }
 
   [[nodiscard]] size_t ContentLength() const { return content_length_; }
   void SetContentLength(size_t content_length) { content_length_ = content_length; }
 
+  /**
+   * @brief A file body replaces Body(), it is written without being copied to user space.
+   */
+  [[nodiscard]] const std::optional<FileBody>& File() const { return file_; }
+  void SetFile(FileBody file) { file_ = std::move(file); }
+
+  /**
+   * @brief Length of the body on the wire, Content-Length.
+   */
+  [[nodiscard]] std::uint64_t BodySize() const {
+    return file_.has_value() ? file_->length : body_.size();
+  }
+
   [[nodiscard]] const types::camille::CamilleHeaders& Headers() const { return headers_; }
   void AddHeader(std::string_view key, std::string_view value) {
-    headers_.emplace_back(std::string(key), std::string(value));
+    headers_.emplace_back(key, value);
   }
   /**
    * @brief Get the Header object (checks for duplicates and emptiness)
@@ -63,32 +127,345 @@ class Response {
   void SetSize(size_t size) { response_size = size; }
   void AddSize(size_t size) { response_size += size; }
 
+  /**
+   * @brief One debug record for the whole response.
+   */
   void PrintResponse() const {
-    CAMILLE_DEBUG("Method: {}", method_);
-    CAMILLE_DEBUG("Uri: {}", path_);
-    CAMILLE_DEBUG("Version: {}", version_);
-    CAMILLE_DEBUG("Host: {}", host_);
-    CAMILLE_DEBUG("Port: {}", port_);
-    for (const auto& [key, value] : headers_) {
-      CAMILLE_DEBUG("Header Key: {}", key);
-      CAMILLE_DEBUG("Header Value: {}", value);
-    }
-    CAMILLE_DEBUG("Content-Length: {}", content_length_);
+    CAMILLE_DEBUG("{} {} HTTP/{} | Host: {}:{} | Headers: {} | Content-Length: {}", method_, path_,
+                  version_, host_, port_, headers_, content_length_);
   }
 
  private:
-  std::string host_;
-  std::string port_;
-  std::string path_;
-  std::string body_;
-  std::string method_;
-  std::string version_;
-  size_t content_length_;
+  types::camille::CamilleString host_;
+  types::camille::CamilleString port_;
+  types::camille::CamilleString path_;
+  types::camille::CamilleString body_;
+  types::camille::CamilleString method_;
+  types::camille::CamilleString version_;
+  size_t content_length_{0};
   types::camille::CamilleHeaders headers_;
+  std::optional<FileBody> file_;
+  infra::StatusCodes status_code_{infra::StatusCodes::kOk};
+  bool has_status_{false};
 
   size_t response_size{0};
 };
 
+/**
+ * @brief What a response says about its connection: nothing for a persistent HTTP/1.1 connection,
+ * "Connection: close", or "Connection: keep-alive" for an HTTP/1.0 client that asked to keep it.
+ */
+enum class Connection : std::uint8_t { kPersistent, kClose, kKeepAlive };
+
+static constexpr std::size_t kConnectionKinds = 3;
+
+/**
+ * @brief The Connection of a response to a request that keeps (or not) its connection.
+ * @param version - of the request, HTTP/1.0 only stays open when the response says so.
+ */
+static constexpr Connection ConnectionFor(bool keep_alive, std::string_view version) {
+  if (!keep_alive) {
+    return Connection::kClose;
+  }
+  return version == "1.0" ? Connection::kKeepAlive : Connection::kPersistent;
+}
+
+/**
+ * @brief Appends status lines and header blocks to a text buffer leased from the thread's
+ * memory::BufferPool on first use and kept until the writer is destroyed.
+ * @details Status lines are copied from the compile-time infra::StatusLine() table, integers are
+ * formatted with std::to_chars and End() emits Content-Length, so once the buffer has grown to its
+ * working size building headers no longer allocates.
+ */
+class ResponseWriter {
+ public:
+  ResponseWriter() = default;
+
+  void Status(infra::StatusCodes status_code) {
+    auto line = infra::StatusLine(status_code);
+    if (!line.empty()) {
+      Append(line);
+      return;
+    }
+    Append(infra::kStatusLineVersion);
+    AppendNumber(static_cast<std::uint16_t>(status_code));
+    Append(" ");
+    Append(infra::ReasonPhrase(status_code));
+    Append(infra::kCrlf);
+  }
+
+  void Header(std::string_view name, std::string_view value) {
+    Text().append(name).append(": ").append(value).append(infra::kCrlf);
+  }
+  void Header(std::string_view name, std::uint64_t value) {
+    Text().append(name).append(": ");
+    AppendNumber(value);
+    Append(infra::kCrlf);
+  }
+
+  /**
+   * @brief Content-Length (unless nullopt), the Connection header if connection needs one, then
+   * the end of the headers.
+   */
+  void End(std::optional<std::uint64_t> content_length, Connection connection) {
+    if (content_length.has_value()) {
+      Header(infra::headers::kContentLength, content_length.value());
+    }
+    if (connection == Connection::kClose) {
+      Header(infra::headers::kConnection, "close");
+    } else if (connection == Connection::kKeepAlive) {
+      Header(infra::headers::kConnection, "keep-alive");
+    }
+    Append(infra::kCrlf);
+  }
+
+  void Append(std::string_view text) { Text().append(text); }
+
+  [[nodiscard]] std::size_t Size() const { return lease_ ? lease_.Buffer().size() : 0; }
+  [[nodiscard]] const char* Data() const { return lease_ ? lease_.Buffer().data() : nullptr; }
+  [[nodiscard]] std::string_view View() const { return {Data(), Size()}; }
+
+  /**
+   * @brief Empties the buffer and keeps its capacity.
+   */
+  void Clear() {
+    if (lease_) {
+      lease_.Buffer().clear();
+    }
+  }
+
+ private:
+  std::string& Text() {
+    if (!lease_) {
+      lease_ = memory::ThreadBufferPool().Acquire();
+    }
+    return lease_.Buffer();
+  }
+
+  void AppendNumber(std::uint64_t number) {
+    std::array<char, 20> digits{};
+    auto [end, ec] = std::to_chars(digits.data(), digits.data() + digits.size(), number);
+    Text().append(digits.data(), end);
+  }
+
+  memory::BufferLease lease_;
+};
+
+/**
+ * @brief A response serialized once (status line, headers, body), for the routes that always answer
+ * the same bytes (health checks, robots.txt, version).
+ * @details The wire bytes are immutable and shared by every thread, they are split around the value
+ * of the Date header so a write gathers prefix, the cached date and suffix without building or
+ * allocating anything.
+ */
+class StaticResponse {
+ public:
+  explicit StaticResponse(Response response)
+      : response_(std::move(response)) {
+    ResponseWriter writer;
+    writer.Status(response_.Status());
+    writer.Append(infra::headers::kDate);
+    writer.Append(": ");
+    std::string prefix{writer.View()};
+
+    for (auto connection : {Connection::kPersistent, Connection::kClose, Connection::kKeepAlive}) {
+      writer.Clear();
+      writer.Append(infra::kCrlf);
+      for (const auto& [key, value] : response_.Headers()) {
+        if (!infra::IEquals(key, infra::headers::kDate)) {
+          writer.Header(key, value);
+        }
+      }
+      writer.End(response_.Body().size(), connection);
+      writer.Append(response_.Body());
+      auto& wire = wire_[static_cast<std::size_t>(connection)];
+      wire.prefix = prefix;
+      wire.suffix = writer.View();
+    }
+  }
+
+  [[nodiscard]] infra::StatusCodes Status() const { return response_.Status(); }
+  /**
+   * @brief The response it was built from.
+   */
+  [[nodiscard]] const Response& Source() const { return response_; }
+
+  /**
+   * @brief Status line up to the Date value.
+   */
+  [[nodiscard]] std::string_view Prefix(Connection connection) const {
+    return wire_[static_cast<std::size_t>(connection)].prefix;
+  }
+  /**
+   * @brief From the end of the Date value to the end of the body.
+   */
+  [[nodiscard]] std::string_view Suffix(Connection connection) const {
+    return wire_[static_cast<std::size_t>(connection)].suffix;
+  }
+
+ private:
+  struct Wire {
+    std::string prefix;
+    std::string suffix;
+  };
+
+  Response response_;
+  std::array<Wire, kConnectionKinds> wire_;
+};
+
+/**
+ * @brief Serializes a batch of responses for a single gather write.
+ * @details Every response becomes its head (status line and headers, written by a ResponseWriter)
+ * and its body, each a separate asio::const_buffer, the body is referenced in place and never
+ * copied. The heads share the writer's pooled buffer, kept (with its capacity) across batches. A
+ * StaticResponse is its prefix, the date and its suffix. A FileBody is not a buffer, it ends a
+ * Segment and the session sends it from its descriptor.
+ */
+class Serializer {
+ public:
+  struct Segment {
+    std::span<const types::aio::AsioIOConstBuffer> buffers;
+    const FileBody* file;
+  };
+
+  Serializer() = default;
+
+  [[nodiscard]] bool Empty() const { return responses_.empty(); }
+  [[nodiscard]] size_t Count() const { return responses_.size(); }
+
+  /**
+   * @brief Queues a response behind the previous ones, it is owned until Clear().
+   * @param response
+   * @param connection - see Connection.
+   * @param head_request - answers a HEAD, the headers describe the body but it is not sent.
+   */
+  void Add(Response response, Connection connection, bool head_request = false) {
+    Entry entry{};
+    entry.text_offset = writer_.Size();
+    writer_.Status(response.Status());
+    bool has_date{false};
+    for (const auto& [key, value] : response.Headers()) {
+      has_date = has_date || infra::IEquals(key, infra::headers::kDate);
+      writer_.Header(key, value);
+    }
+    if (!has_date) {
+      auto date = date::Cache::Instance().Read();
+      writer_.Header(infra::headers::kDate, std::string_view(date.data(), date.size()));
+    }
+    // 1xx, 204 and 304 never carry a body, a Content-Length there would describe another one.
+    auto code = static_cast<std::uint16_t>(response.Status());
+    auto bodyless = code < 200 || response.Status() == infra::StatusCodes::kNoContent ||
+                    response.Status() == infra::StatusCodes::kNotModified;
+    writer_.End(bodyless ? std::nullopt : std::optional{response.BodySize()}, connection);
+    entry.text_end = writer_.Size();
+    // a body set anyway would be read as the start of the next response.
+    entry.body = !bodyless && !head_request;
+    entries_.push_back(entry);
+    responses_.push_back(std::move(response));
+  }
+
+  /**
+   * @brief Queues a pre-serialized response, only its Date is copied into the batch.
+   * @param response - must outlive the write (owned by the route table)
+   * @param connection - selects the variant with the matching Connection header.
+   */
+  void Add(const StaticResponse& response, Connection connection) {
+    Entry entry{};
+    entry.text_offset = writer_.Size();
+    auto date = date::Cache::Instance().Read();
+    writer_.Append(std::string_view(date.data(), date.size()));
+    entry.text_end = writer_.Size();
+    entry.static_response = &response;
+    entry.connection = connection;
+    entry.body = true;
+    entries_.push_back(entry);
+    responses_.emplace_back();
+  }
+
+  /**
+   * @brief The gather list of the whole batch, valid until the next Add() or Clear().
+   */
+  [[nodiscard]] const types::camille::CamilleVector<types::aio::AsioIOConstBuffer>& Buffers() {
+    buffers_.clear();
+    for (size_t index{0}; index < entries_.size(); ++index) {
+      const auto& entry = entries_[index];
+      const auto* text = writer_.Data() + entry.text_offset;
+      auto text_size = entry.text_end - entry.text_offset;
+      if (entry.static_response != nullptr) {
+        auto prefix = entry.static_response->Prefix(entry.connection);
+        auto suffix = entry.static_response->Suffix(entry.connection);
+        buffers_.emplace_back(prefix.data(), prefix.size());
+        buffers_.emplace_back(text, text_size);
+        buffers_.emplace_back(suffix.data(), suffix.size());
+        continue;
+      }
+      buffers_.emplace_back(text, text_size);
+      if (!entry.body || responses_[index].File().has_value()) {
+        continue;
+      }
+      auto body = responses_[index].Body();
+      if (!body.empty()) {
+        buffers_.emplace_back(body.data(), body.size());
+      }
+    }
+    return buffers_;
+  }
+
+  /**
+   * @brief Buffers() split around the file bodies: every segment is a gather write followed by an
+   * optional file, valid until the next Add() or Clear().
+   */
+  [[nodiscard]] const types::camille::CamilleVector<Segment>& Segments() {
+    const auto& buffers = Buffers();
+    segments_.clear();
+    size_t begin{0};
+    size_t end{0};
+    for (size_t index{0}; index < entries_.size(); ++index) {
+      end += entries_[index].static_response != nullptr ? 3 : 1;
+      if (!entries_[index].body) {
+        continue;
+      }
+      const auto& file = responses_[index].File();
+      if (file.has_value()) {
+        segments_.push_back({{buffers.data() + begin, end - begin}, &file.value()});
+        begin = end;
+      } else if (!responses_[index].Body().empty()) {
+        ++end;
+      }
+    }
+    if (begin < buffers.size()) {
+      segments_.push_back({{buffers.data() + begin, buffers.size() - begin}, nullptr});
+    }
+    return segments_;
+  }
+
+  void Clear() {
+    writer_.Clear();
+    entries_.clear();
+    buffers_.clear();
+    segments_.clear();
+    responses_.clear();
+  }
+
+ private:
+  /**
+   * @brief Range of the writer's buffer holding the head, or the date of a static response.
+   */
+  struct Entry {
+    size_t text_offset;
+    size_t text_end;
+    const StaticResponse* static_response;
+    Connection connection;
+    bool body;  // false for 1xx, 204, 304 and HEAD, only the head is written.
+  };
+
+  ResponseWriter writer_;
+  types::camille::CamilleVector<Entry> entries_;
+  types::camille::CamilleVector<Response> responses_;
+  types::camille::CamilleVector<types::aio::AsioIOConstBuffer> buffers_;
+  types::camille::CamilleVector<Segment> segments_;
+};
+
 };  // namespace response
 };  // namespace camille
 
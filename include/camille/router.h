@@ -1,26 +1,192 @@
 #ifndef CAMILLE_INCLUDE_CAMILLE_ROUTER_H_
 #define CAMILLE_INCLUDE_CAMILLE_ROUTER_H_
 
+#include <expected>
+#include <functional>
+#include <memory>
 #include <string>
 #include <optional>
+#include <variant>
 
+#include "asio/awaitable.hpp"
+
+#include "benchmark.h"
 #include "infra.h"
+#include "datastructures.h"
+#include "files.h"
+#include "parser.h"
+#include "request.h"
+#include "response.h"
 
 namespace camille {
 namespace router {
 
+/**
+ * @brief Route handler, the request is a view over the session buffer (see RequestView).
+ */
+using Handler = std::function<response::Response(const request::RequestView&)>;
+/**
+ * @brief Coroutine route handler, it runs on the session's io_context and can co_await any asio
+ * operation (database, cache, upstream) without blocking the thread. The request stays valid until
+ * the handler completes.
+ */
+using AsyncHandler =
+    std::function<asio::awaitable<response::Response>(const request::RequestView&)>;
+
+/**
+ * @brief Makes the sink of a chunked request body from the request head, the sink then receives
+ * every decoded chunk as it arrives and the handler runs once the body is complete, with an empty
+ * body. The head is only valid during the call.
+ */
+using BodyHandler = std::function<parser::Parser::BodySink(const request::RequestView&)>;
+
+/**
+ * @brief kOffload runs the handler on the server's pool::TaskPool instead of the io_context thread,
+ * for the handlers that block or crunch (JSON, compression).
+ */
+enum class Execution : std::uint8_t { kInline, kOffload };
+
+/**
+ * @brief Pre-serialized answer of a route, shared by the copies of the route.
+ */
+using StaticHandler = std::shared_ptr<const response::StaticResponse>;
+
+struct Route {
+  infra::Methods method;
+  std::string path;
+  infra::StatusCodes status_code;
+  std::variant<Handler, AsyncHandler, StaticHandler> handler;
+  Execution execution{Execution::kInline};
+  BodyHandler body{};
+
+  [[nodiscard]] bool IsAsync() const { return std::holds_alternative<AsyncHandler>(handler); }
+  /**
+   * @return the pre-serialized response, nullptr for a handler route
+   */
+  [[nodiscard]] const response::StaticResponse* Static() const {
+    const auto* handler_static = std::get_if<StaticHandler>(&handler);
+    return handler_static != nullptr ? handler_static->get() : nullptr;
+  }
+};
+
 class Router {
  public:
-  Router(const std::string& prefix, const std::optional<std::string>& tag);
+  Router(const std::string& prefix, const std::optional<std::string>& tag)
+      : prefix_(prefix),
+        tag_(tag) {}
   ~Router() = default;
 
-  void Head(const std::string& path, infra::StatusCodes status_code);
-  void Get(const std::string& path, infra::StatusCodes status_code);
-  void Post(const std::string& path, infra::StatusCodes status_code);
-  void Patch(const std::string& path, infra::StatusCodes status_code);
-  void Put(const std::string& path, infra::StatusCodes status_code);
-  void Options(const std::string& path, infra::StatusCodes status_code);
-  void Delete(const std::string& path, infra::StatusCodes status_code);
+  /**
+   * @brief status_code is the default status of the responses that don't set one, coroutine
+   * handlers (AsyncHandler) always run inline.
+   */
+  void Head(const std::string& path,
+            infra::StatusCodes status_code,
+            Handler handler,
+            Execution execution = Execution::kInline) {
+    Add(infra::Methods::kHead, path, status_code, std::move(handler), execution);
+  }
+  void Head(const std::string& path, infra::StatusCodes status_code, AsyncHandler handler) {
+    Add(infra::Methods::kHead, path, status_code, std::move(handler), Execution::kInline);
+  }
+  void Get(const std::string& path,
+           infra::StatusCodes status_code,
+           Handler handler,
+           Execution execution = Execution::kInline) {
+    Add(infra::Methods::kGet, path, status_code, std::move(handler), execution);
+  }
+  void Get(const std::string& path, infra::StatusCodes status_code, AsyncHandler handler) {
+    Add(infra::Methods::kGet, path, status_code, std::move(handler), Execution::kInline);
+  }
+  /**
+   * @brief Always answers response, serialized once here (a response without a status is a 200).
+   */
+  void Get(const std::string& path, response::Response response) {
+    if (!response.HasStatus()) {
+      response.SetStatus(infra::StatusCodes::kOk);
+    }
+    auto status_code = response.Status();
+    Add(infra::Methods::kGet, path, status_code,
+        std::make_shared<const response::StaticResponse>(std::move(response)), Execution::kInline);
+  }
+  void Post(const std::string& path,
+            infra::StatusCodes status_code,
+            Handler handler,
+            Execution execution = Execution::kInline) {
+    Add(infra::Methods::kPost, path, status_code, std::move(handler), execution);
+  }
+  void Post(const std::string& path, infra::StatusCodes status_code, AsyncHandler handler) {
+    Add(infra::Methods::kPost, path, status_code, std::move(handler), Execution::kInline);
+  }
+  /**
+   * @brief Streams a chunked request body into the sink made by body (see BodyHandler), e.g. an
+   * upload written to disk as it arrives instead of being held in memory.
+   */
+  void Post(const std::string& path,
+            infra::StatusCodes status_code,
+            BodyHandler body,
+            Handler handler,
+            Execution execution = Execution::kInline) {
+    Add(infra::Methods::kPost, path, status_code, std::move(handler), execution, std::move(body));
+  }
+  void Patch(const std::string& path,
+             infra::StatusCodes status_code,
+             Handler handler,
+             Execution execution = Execution::kInline) {
+    Add(infra::Methods::kPatch, path, status_code, std::move(handler), execution);
+  }
+  void Patch(const std::string& path, infra::StatusCodes status_code, AsyncHandler handler) {
+    Add(infra::Methods::kPatch, path, status_code, std::move(handler), Execution::kInline);
+  }
+  void Put(const std::string& path,
+           infra::StatusCodes status_code,
+           Handler handler,
+           Execution execution = Execution::kInline) {
+    Add(infra::Methods::kPut, path, status_code, std::move(handler), execution);
+  }
+  void Put(const std::string& path, infra::StatusCodes status_code, AsyncHandler handler) {
+    Add(infra::Methods::kPut, path, status_code, std::move(handler), Execution::kInline);
+  }
+  void Put(const std::string& path,
+           infra::StatusCodes status_code,
+           BodyHandler body,
+           Handler handler,
+           Execution execution = Execution::kInline) {
+    Add(infra::Methods::kPut, path, status_code, std::move(handler), execution, std::move(body));
+  }
+  void Options(const std::string& path,
+               infra::StatusCodes status_code,
+               Handler handler,
+               Execution execution = Execution::kInline) {
+    Add(infra::Methods::kOptions, path, status_code, std::move(handler), execution);
+  }
+  void Options(const std::string& path, infra::StatusCodes status_code, AsyncHandler handler) {
+    Add(infra::Methods::kOptions, path, status_code, std::move(handler), Execution::kInline);
+  }
+  void Delete(const std::string& path,
+              infra::StatusCodes status_code,
+              Handler handler,
+              Execution execution = Execution::kInline) {
+    Add(infra::Methods::kDelete, path, status_code, std::move(handler), execution);
+  }
+  void Delete(const std::string& path, infra::StatusCodes status_code, AsyncHandler handler) {
+    Add(infra::Methods::kDelete, path, status_code, std::move(handler), Execution::kInline);
+  }
+
+  /**
+   * @brief Serves the files under files' root below path, e.g. Files("/assets", StaticFiles{"www"})
+   * answers GET (and HEAD) /assets/app.js with www/app.js (written with sendfile by the session).
+   */
+  void Files(const std::string& path,
+             files::StaticFiles files,
+             Execution execution = Execution::kInline) {
+    Handler handler{[files = std::move(files)](const request::RequestView& request) {
+      return files.Serve(request, request.Param("path").value_or(""));
+    }};
+    Add(infra::Methods::kHead, path + "/*path", infra::StatusCodes::kOk, handler, execution);
+    Add(infra::Methods::kGet, path + "/*path", infra::StatusCodes::kOk, std::move(handler),
+        execution);
+  }
 
   /**
    * @brief Acts as a wrapper (aka python decorator)
@@ -31,13 +197,119 @@ class Router {
   template <typename MethodType, typename... Args>
   void ToMacro(const MethodType& method);
 
+  [[nodiscard]] const std::string& Prefix() const { return prefix_; }
+  [[nodiscard]] const std::optional<std::string>& Tag() const { return tag_; }
+  [[nodiscard]] const std::vector<Route>& Routes() const { return routes_; }
+
  private:
+  void Add(infra::Methods method,
+           const std::string& path,
+           infra::StatusCodes status_code,
+           std::variant<Handler, AsyncHandler, StaticHandler> handler,
+           Execution execution,
+           BodyHandler body = {}) {
+    routes_.push_back(
+        {method, prefix_ + path, status_code, std::move(handler), execution, std::move(body)});
+  }
+
   std::string prefix_;
   std::optional<std::string> tag_;
+  std::vector<Route> routes_;
   // std::shared_ptr<server::Client> server_;
 };
 
+/**
+ * @brief Every registered route, shared read-only by all the sessions once the server runs.
+ */
+class RouteTable {
+ public:
+  RouteTable() = default;
+
+  void Add(const Router& router) {
+    for (const auto& route : router.Routes()) {
+      tree_.Insert(route.method, route.path, route);
+      offload_ = offload_ || route.execution == Execution::kOffload;
+    }
+  }
+
+  /**
+   * @brief Routes the request (query string excluded) and binds its path params.
+   * @return the route, or 404 for an unknown path and 405 for a known path without this method
+   */
+  [[nodiscard]] std::expected<const Route*, infra::StatusCodes> Find(
+      request::RequestView& request) const {
+    auto path = request.Path();
+    path = path.substr(0, path.find_first_of("?#"));
+
+    auto route_start = benchmark::Clock::now();
+    auto match = tree_.Find(request.MethodId(), path);
+    benchmark::Record(benchmark::Phase::kRoute, benchmark::Clock::now() - route_start);
+    if (match.value == nullptr) {
+      return std::unexpected(match.path_found ? infra::StatusCodes::kMethodNotAllowed
+                                              : infra::StatusCodes::kNotFound);
+    }
+    request.SetParams(match.params);
+    return match.value;
+  }
+
+  /**
+   * @brief Runs the handler of a synchronous route, on whichever thread calls it.
+   */
+  static response::Response Invoke(const Route& route, const request::RequestView& request) {
+    auto handler_start = benchmark::Clock::now();
+    auto response = std::get<Handler>(route.handler)(request);
+    benchmark::Record(benchmark::Phase::kHandler, benchmark::Clock::now() - handler_start);
+    if (!response.HasStatus()) {
+      response.SetStatus(route.status_code);
+    }
+    return response;
+  }
+
+  /**
+   * @brief Awaits the handler of a coroutine route (the handler phase includes its suspensions).
+   */
+  static asio::awaitable<response::Response> InvokeAsync(const Route& route,
+                                                         const request::RequestView& request) {
+    auto handler_start = benchmark::Clock::now();
+    auto response = co_await std::get<AsyncHandler>(route.handler)(request);
+    benchmark::Record(benchmark::Phase::kHandler, benchmark::Clock::now() - handler_start);
+    if (!response.HasStatus()) {
+      response.SetStatus(route.status_code);
+    }
+    co_return response;
+  }
+
+  /**
+   * @brief Find() and Invoke() inline, 404 for an unknown path and 405 for a known path without
+   * this method (500 for a coroutine route, those are awaited with InvokeAsync()).
+   */
+  [[nodiscard]] response::Response Dispatch(request::RequestView& request) const {
+    auto route = Find(request);
+    if (!route) {
+      return response::Response{route.error()};
+    }
+    if ((*route)->IsAsync()) {
+      return response::Response{infra::StatusCodes::kInternalServerError};
+    }
+    if (const auto* response_static = (*route)->Static()) {
+      return response_static->Source();
+    }
+    return Invoke(**route, request);
+  }
+
+  /**
+   * @brief Whether any route runs on the task pool.
+   */
+  [[nodiscard]] bool HasOffload() const { return offload_; }
+
+  [[nodiscard]] size_t Size() const { return tree_.Size(); }
+
+ private:
+  datastructure::PrefixTree<Route> tree_;
+  bool offload_{false};
+};
+
 };  // namespace router
 };  // namespace camille
 
-#endif
\ No newline at end of file
+#endif
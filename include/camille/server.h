@@ -7,57 +7,135 @@
 
 #include "asio/ip/address.hpp"
 
+#include <algorithm>
 #include <system_error>
 #include <thread>
 
 namespace camille {
 namespace server {
 
+static constexpr logger::Module kCamilleLogModule = logger::Module::kNetwork;
+
+/**
+ * @brief With reuse_port every io_context listens on its own SO_REUSEPORT acceptor, the kernel
+ * spreads the connections and each one stays on the thread that accepted it. Otherwise a single
+ * acceptor hands the sockets round-robin to the pool.
+ */
 class Server {
  public:
   Server(const std::string& host,
          std::uint16_t port,
-         concepts::UnsignedIntegral auto pool_size = std::thread::hardware_concurrency())
-      : io_context_pool_(pool_size == 0 ? 1 : pool_size),
-        acceptor_(io_context_pool_.GetIOContext(),
-                  asio::ip::tcp::endpoint(asio::ip::make_address(host), port)) {
+         types::camille::CamilleShared<const router::RouteTable> routes,
+         concepts::UnsignedIntegral auto pool_size = std::thread::hardware_concurrency(),
+         bool reuse_port = false)
+      : routes_(std::move(routes)),
+        io_context_pool_(pool_size == 0 ? 1 : pool_size) {
     if (pool_size == 0) {
       CAMILLE_CRITICAL("Server pool_size initialized with 0, Defaulting to 1");
     }
-    StartAccept();
+    asio::ip::tcp::endpoint endpoint(asio::ip::make_address(host), port);
+#ifndef SO_REUSEPORT
+    if (reuse_port) {
+      CAMILLE_ERROR("SO_REUSEPORT is not supported on this platform, using a single acceptor");
+      reuse_port = false;
+    }
+#endif
+    if (!reuse_port) {
+      acceptors_.emplace_back(io_context_pool_.GetIOContext(), endpoint);
+    } else {
+      for (std::size_t index{0}; index < io_context_pool_.Size(); ++index) {
+        acceptors_.push_back(OpenReusePort(io_context_pool_.GetIOContext(index), endpoint));
+      }
+    }
+    for (auto& acceptor : acceptors_) {
+      StartAccept(acceptor, reuse_port);
+    }
   }
+  /**
+   * @brief Stops accepting, then joins the io threads before the task pool goes away, a session
+   * that is still offloading submits to it until its io_context thread has exited.
+   */
   ~Server() {
+    for (auto& acceptor : acceptors_) {
+      if (acceptor.is_open()) {
+        std::error_code error_code;
+        acceptor.close(error_code);
+      }
+    }
     io_context_pool_.Stop();
-    if (acceptor_.is_open()) {
-      std::error_code error_code;
-      acceptor_.close(error_code);
+    io_context_pool_.Wait();
+    if (tasks_) {
+      tasks_->Stop();
+      tasks_.reset();
     }
   }
 
-  explicit operator bool() const { return acceptor_.is_open(); }
+  explicit operator bool() const {
+    return !acceptors_.empty() &&
+           std::ranges::all_of(acceptors_, [](const auto& acceptor) { return acceptor.is_open(); });
+  }
 
   void SetState(bool state) { state_ = state; }
+  void SetTimeouts(const network::Timeouts& timeouts) { timeouts_ = timeouts; }
+  void SetAffinity(const affinity::Options& options) { io_context_pool_.SetAffinity(options); }
+  /**
+   * @brief Workers of the task pool, started on Run() when a route is offloaded.
+   */
+  void SetTaskPoolSize(unsigned task_pool_size) { task_pool_size_ = task_pool_size; }
+
+  [[nodiscard]] int ConnectionCount() const { return connections_.count(); }
 
   void Run(std::function<void()> callback) {
+    if (routes_ && routes_->HasOffload() && !tasks_) {
+      tasks_ = std::make_unique<pool::TaskPool>(task_pool_size_);
+    }
     io_context_pool_.Run();
     callback();
     io_context_pool_.Wait();
   }
 
  private:
-  void StartAccept() {
-    auto& client_ctx = io_context_pool_.GetIOContext();
-    auto new_socket = std::make_shared<types::aio::AsioIOSocket>(client_ctx);
+  static types::aio::AsioIOAcceptor OpenReusePort(types::aio::AsioIOContext& ctx,
+                                                  const asio::ip::tcp::endpoint& endpoint) {
+    types::aio::AsioIOAcceptor acceptor(ctx);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(types::aio::AsioIOAcceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+    acceptor.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#endif
+    acceptor.bind(endpoint);
+    acceptor.listen();
+    return acceptor;
+  }
+
+  /**
+   * @param local the socket is accepted on the acceptor's own io_context, no hop is needed
+   */
+  void StartAccept(types::aio::AsioIOAcceptor& acceptor, bool local) {
+    auto new_socket = local ? std::make_shared<types::aio::AsioIOSocket>(acceptor.get_executor())
+                            : std::make_shared<types::aio::AsioIOSocket>(
+                                  io_context_pool_.GetIOContext());
 
-    acceptor_.async_accept(*new_socket, [this, new_socket](const std::error_code& error_code) {
+    acceptor.async_accept(*new_socket, [this, &acceptor, local,
+                                        new_socket](const std::error_code& error_code) {
       if (!error_code) {
-        std::make_shared<network::Session>(new_socket, state_)->Start();
+        metrics::Builtins::Instance().connections_accepted.Add();
+        if (local) {
+          std::make_shared<network::Session>(new_socket, routes_, state_, timeouts_, tasks_.get())
+              ->Start();
+        } else {
+          // The session runs on the io_context that owns its socket, not on the acceptor's.
+          asio::post(new_socket->get_executor(), [this, new_socket]() {
+            std::make_shared<network::Session>(new_socket, routes_, state_, timeouts_, tasks_.get())
+              ->Start();
+          });
+        }
       } else {
         CAMILLE_CRITICAL("Async Accept Error, {}", error_code.message());
       }
 
-      if (acceptor_.is_open()) {
-        StartAccept();
+      if (acceptor.is_open()) {
+        StartAccept(acceptor, local);
         CAMILLE_DEBUG("Acceptor is open for connetions");
       } else {
         CAMILLE_ERROR("Server error, acceptor is closed");
@@ -67,8 +145,19 @@ class Server {
 
  private:
   bool state_{false};
+  network::Timeouts timeouts_;
+  ConnectionManager connections_;
+  types::camille::CamilleShared<const router::RouteTable> routes_;
   pool::ContextPool io_context_pool_;
-  types::aio::AsioIOAcceptor acceptor_;
+  unsigned task_pool_size_{std::thread::hardware_concurrency()};
+  /**
+   * @brief Declared after the io_context pool, its workers post back into the io_contexts.
+   */
+  types::camille::CamilleUnique<pool::TaskPool> tasks_;
+  /**
+   * @brief Never resized after the constructor, the accept handlers hold references into it.
+   */
+  types::camille::CamilleVector<types::aio::AsioIOAcceptor> acceptors_;
 };
 
 };  // namespace server
@@ -0,0 +1,168 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_SIMD_H_
+#define CAMILLE_INCLUDE_CAMILLE_SIMD_H_
+
+#include <cstddef>
+#include <string_view>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CAMILLE_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Vectorized scanning for the parser hot loops.
+ * @details Each kernel returns how many leading bytes belong to the "plain" class of a field, the
+ * parser then handles the byte it stopped at with the scalar ParserTraits (delimiters, CR, rare
+ * but valid symbols, errors). The kernels are chosen once at runtime with CPUID, the scalar kernel
+ * skips nothing so the parser runs exactly as before on other targets.
+ */
+
+namespace camille {
+namespace simd {
+
+using ScanFunction = size_t (*)(const char* data, size_t size);
+
+struct Kernels {
+  std::string_view name;
+  ScanFunction header_key;
+  ScanFunction header_value;
+  ScanFunction uri;
+};
+
+inline size_t ScanNone(const char*, size_t) { return 0; }
+
+#if defined(CAMILLE_SIMD_X86)
+
+/**
+ * @brief Ranges for _mm_cmpestri, the kernel stops at the first byte outside all of them.
+ * @details header key: 0-9 A-Z a-z '-' (other tchars fall back to the traits), header value:
+ * VCHAR and SP, uri: VCHAR without '%'.
+ */
+inline constexpr char kHeaderKeyRanges[16] = "09AZaz--";
+inline constexpr int kHeaderKeyRangesSize = 8;
+inline constexpr char kHeaderValueRanges[16] = "\x20\x7e";
+inline constexpr int kHeaderValueRangesSize = 2;
+inline constexpr char kUriRanges[16] = "\x21\x24\x26\x7e";
+inline constexpr int kUriRangesSize = 4;
+
+static constexpr int kRangesMode = _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY |
+                                   _SIDD_LEAST_SIGNIFICANT;
+
+__attribute__((target("sse4.2"))) inline size_t ScanRangesSse42(const char* data,
+                                                                 size_t size,
+                                                                 const char* ranges,
+                                                                 int ranges_size) {
+  const __m128i needle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ranges));
+  size_t pos{0};
+  while (size - pos >= 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    int index = _mm_cmpestri(needle, ranges_size, block, 16, kRangesMode);
+    if (index != 16) {
+      return pos + static_cast<size_t>(index);
+    }
+    pos += 16;
+  }
+  return pos;
+}
+
+__attribute__((target("sse4.2"))) inline size_t ScanHeaderKeySse42(const char* data, size_t size) {
+  return ScanRangesSse42(data, size, kHeaderKeyRanges, kHeaderKeyRangesSize);
+}
+__attribute__((target("sse4.2"))) inline size_t ScanHeaderValueSse42(const char* data,
+                                                                      size_t size) {
+  return ScanRangesSse42(data, size, kHeaderValueRanges, kHeaderValueRangesSize);
+}
+__attribute__((target("sse4.2"))) inline size_t ScanUriSse42(const char* data, size_t size) {
+  return ScanRangesSse42(data, size, kUriRanges, kUriRangesSize);
+}
+
+/**
+ * @brief Masks of the bytes that stop the scan, one bit per byte of the 32 byte block at data.
+ */
+__attribute__((target("avx2"))) inline unsigned StopHeaderKeyAvx2(const char* data) {
+  const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), block));
+  const __m256i lower = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+  const __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+  const __m256i dash = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('-'));
+  const __m256i plain = _mm256_or_si256(_mm256_or_si256(digit, alpha), dash);
+  return ~static_cast<unsigned>(_mm256_movemask_epi8(plain));
+}
+
+__attribute__((target("avx2"))) inline unsigned StopHeaderValueAvx2(const char* data) {
+  const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  // signed compare, so bytes >= 0x80 count as below SP as well.
+  const __m256i control = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), block);
+  const __m256i del = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(0x7f));
+  return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(control, del)));
+}
+
+__attribute__((target("avx2"))) inline unsigned StopUriAvx2(const char* data) {
+  const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  const __m256i control = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x21), block);
+  const __m256i del = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(0x7f));
+  const __m256i percent = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('%'));
+  return static_cast<unsigned>(
+      _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(control, del), percent)));
+}
+
+/**
+ * @brief Scans 32 byte blocks, the tail (16 to 31 bytes) goes to the SSE4.2 kernel.
+ * @tparam StopMask
+ * @tparam Tail
+ */
+template <unsigned (*StopMask)(const char*), ScanFunction Tail>
+__attribute__((target("avx2,sse4.2"))) inline size_t ScanAvx2(const char* data, size_t size) {
+  size_t pos{0};
+  while (size - pos >= 32) {
+    unsigned mask = StopMask(data + pos);
+    if (mask != 0) {
+      return pos + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    pos += 32;
+  }
+  return pos + Tail(data + pos, size - pos);
+}
+
+inline constexpr ScanFunction ScanHeaderKeyAvx2 = ScanAvx2<StopHeaderKeyAvx2, ScanHeaderKeySse42>;
+inline constexpr ScanFunction ScanHeaderValueAvx2 =
+    ScanAvx2<StopHeaderValueAvx2, ScanHeaderValueSse42>;
+inline constexpr ScanFunction ScanUriAvx2 = ScanAvx2<StopUriAvx2, ScanUriSse42>;
+
+#endif
+
+inline Kernels DetectKernels() {
+#if defined(CAMILLE_SIMD_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2")) {
+    return {"avx2", ScanHeaderKeyAvx2, ScanHeaderValueAvx2, ScanUriAvx2};
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return {"sse4.2", ScanHeaderKeySse42, ScanHeaderValueSse42, ScanUriSse42};
+  }
+#endif
+  return {"scalar", ScanNone, ScanNone, ScanNone};
+}
+
+/**
+ * @brief The kernels picked for this CPU, resolved on first use.
+ */
+inline const Kernels& ActiveKernels() {
+  static const Kernels kernels = DetectKernels();
+  return kernels;
+}
+
+inline size_t ScanHeaderKey(const char* data, size_t size) {
+  return ActiveKernels().header_key(data, size);
+}
+inline size_t ScanHeaderValue(const char* data, size_t size) {
+  return ActiveKernels().header_value(data, size);
+}
+inline size_t ScanUri(const char* data, size_t size) { return ActiveKernels().uri(data, size); }
+
+};  // namespace simd
+};  // namespace camille
+
+#endif
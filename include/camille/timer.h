@@ -0,0 +1,229 @@
+#ifndef CAMILLE_INCLUDE_CAMILLE_TIMER_H_
+#define CAMILLE_INCLUDE_CAMILLE_TIMER_H_
+
+#include "asio/execution_context.hpp"
+#include "asio/io_context.hpp"
+#include "asio/steady_timer.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+/**
+ * @brief Timeouts for every connection of an io_context on one hierarchical timer wheel.
+ * @details A connection owns an intrusive TimerNode (no allocation, O(1) schedule and cancel) and
+ * the wheel is driven by a single steady_timer tick per io_context. Like the sessions it serves,
+ * the wheel is only touched from the thread running its io_context.
+ */
+
+namespace camille {
+namespace timer {
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr Clock::duration kTick = std::chrono::milliseconds(100);
+static constexpr std::size_t kSlotBits = 6;
+static constexpr std::size_t kSlots = std::size_t{1} << kSlotBits;
+static constexpr std::uint64_t kSlotMask = kSlots - 1;
+static constexpr std::size_t kLevels = 4;
+/**
+ * @brief Longest timeout the wheel holds (64^4 ticks, ~19 days), longer ones are clamped.
+ */
+static constexpr std::uint64_t kMaxTicks = (std::uint64_t{1} << (kSlotBits * kLevels)) - 1;
+
+class TimerWheel;
+
+class TimerNode {
+ public:
+  using Callback = void (*)(void* owner);
+
+  TimerNode(Callback callback, void* owner)
+      : callback_(callback),
+        owner_(owner) {}
+  ~TimerNode() { Cancel(); }
+
+  TimerNode(const TimerNode&) = delete;
+  TimerNode& operator=(const TimerNode&) = delete;
+
+  [[nodiscard]] bool Armed() const { return slot_ != nullptr; }
+  inline void Cancel();
+
+ private:
+  friend class TimerWheel;
+
+  TimerNode* prev_{nullptr};
+  TimerNode* next_{nullptr};
+  TimerNode** slot_{nullptr};
+  TimerWheel* wheel_{nullptr};
+  std::uint64_t expiry_{0};
+  Callback callback_;
+  void* owner_;
+};
+
+/**
+ * @brief Hashed hierarchical timer wheel, kLevels wheels of kSlots slots, level n slots are
+ * kSlots^n ticks wide and cascade into the level below when the wheel under them wraps.
+ * @details Registered as an io_context service, one per context (asio::use_service).
+ */
+class TimerWheel : public asio::execution_context::service {
+ public:
+  inline static asio::execution_context::id id;
+
+  explicit TimerWheel(asio::io_context& io_context)
+      : asio::execution_context::service(io_context),
+        timer_(io_context) {}
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /**
+   * @brief Starts the tick, called once by the owner of the io_context (pool::ContextPool).
+   */
+  void Start() {
+    if (running_) {
+      return;
+    }
+    running_ = true;
+    start_ = Clock::now();
+    timer_.expires_at(start_ + kTick);
+    Wait();
+  }
+
+  /**
+   * @brief (Re)arms node to fire after timeout, rounded up to the next tick.
+   * @param node
+   * @param timeout
+   */
+  void Schedule(TimerNode& node, Clock::duration timeout) {
+    Remove(node);
+    auto ticks = static_cast<std::uint64_t>((timeout + kTick - Clock::duration{1}) / kTick);
+    if (ticks == 0) {
+      ticks = 1;
+    } else if (ticks > kMaxTicks) {
+      ticks = kMaxTicks;
+    }
+    node.expiry_ = now_ + ticks;
+    node.wheel_ = this;
+    Place(node);
+  }
+
+  void Remove(TimerNode& node) {
+    if (node.slot_ == nullptr) {
+      return;
+    }
+    if (node.prev_ != nullptr) {
+      node.prev_->next_ = node.next_;
+    } else {
+      *node.slot_ = node.next_;
+    }
+    if (node.next_ != nullptr) {
+      node.next_->prev_ = node.prev_;
+    }
+    node.prev_ = nullptr;
+    node.next_ = nullptr;
+    node.slot_ = nullptr;
+    node.wheel_ = nullptr;
+    --size_;
+  }
+
+  /**
+   * @brief Moves the wheel one tick forward, firing every node that expires on it.
+   */
+  void Advance() {
+    ++now_;
+    for (std::size_t level{kLevels - 1}; level > 0; --level) {
+      if ((now_ & ((std::uint64_t{1} << (kSlotBits * level)) - 1)) == 0) {
+        Cascade(level, (now_ >> (kSlotBits * level)) & kSlotMask);
+      }
+    }
+
+    TimerNode*& slot = wheels_[0][now_ & kSlotMask];
+    while (slot != nullptr) {
+      TimerNode& node = *slot;
+      Remove(node);
+      node.callback_(node.owner_);
+    }
+  }
+
+  [[nodiscard]] std::uint64_t Now() const { return now_; }
+  [[nodiscard]] std::size_t Size() const { return size_; }
+
+ private:
+  void shutdown() override {
+    running_ = false;
+    timer_.cancel();
+    for (auto& wheel : wheels_) {
+      for (auto& slot : wheel) {
+        while (slot != nullptr) {
+          Remove(*slot);
+        }
+      }
+    }
+  }
+
+  void Wait() {
+    timer_.async_wait([this](const std::error_code& error_code) {
+      if (error_code || !running_) {
+        return;
+      }
+      // catches up when the thread was busy for more than a tick.
+      auto target = static_cast<std::uint64_t>((Clock::now() - start_) / kTick);
+      while (now_ < target) {
+        Advance();
+      }
+      timer_.expires_at(timer_.expiry() + kTick);
+      Wait();
+    });
+  }
+
+  void Place(TimerNode& node) {
+    std::uint64_t delta = node.expiry_ - now_;
+    std::size_t level{0};
+    while (level + 1 < kLevels && delta >= (std::uint64_t{1} << (kSlotBits * (level + 1)))) {
+      ++level;
+    }
+    TimerNode*& slot = wheels_[level][(node.expiry_ >> (kSlotBits * level)) & kSlotMask];
+    node.prev_ = nullptr;
+    node.next_ = slot;
+    if (slot != nullptr) {
+      slot->prev_ = &node;
+    }
+    slot = &node;
+    node.slot_ = &slot;
+    ++size_;
+  }
+
+  void Cascade(std::size_t level, std::uint64_t index) {
+    TimerNode* node = wheels_[level][index];
+    wheels_[level][index] = nullptr;
+    while (node != nullptr) {
+      TimerNode* next = node->next_;
+      node->prev_ = nullptr;
+      node->next_ = nullptr;
+      node->slot_ = nullptr;
+      --size_;
+      Place(*node);
+      node = next;
+    }
+  }
+
+  bool running_{false};
+  std::uint64_t now_{0};
+  std::size_t size_{0};
+  Clock::time_point start_{};
+  asio::steady_timer timer_;
+  std::array<std::array<TimerNode*, kSlots>, kLevels> wheels_{};
+};
+
+inline void TimerNode::Cancel() {
+  if (wheel_ != nullptr) {
+    wheel_->Remove(*this);
+  }
+}
+
+};  // namespace timer
+};  // namespace camille
+
+#endif
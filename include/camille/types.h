@@ -8,7 +8,9 @@
 #include "asio/streambuf.hpp"
 
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -45,15 +47,27 @@ using CamilleVector = std::vector<VectorType>;
 template <typename Key, typename Value>
 using CamilleUnorderedMap = std::unordered_map<Key, Value>;
 
+/**
+ * @brief Camille Polymorphic Vector, allocates from the resource it is built with
+ * @tparam VectorType
+ */
+template <typename VectorType>
+using CamillePmrVector = std::pmr::vector<VectorType>;
+
+/**
+ * @brief Camille Polymorphic String
+ */
+using CamilleString = std::pmr::string;
+
 /**
  * @brief Headers data structure
  */
-using CamilleHeaders = CamilleVector<std::pair<std::string, std::string>>;
+using CamilleHeaders = CamillePmrVector<std::pair<CamilleString, CamilleString>>;
 
 /**
  * @brief Headers data structure string_view
  */
-using CamilleViewHeaders = CamilleVector<std::pair<std::string_view, std::string_view>>;
+using CamilleViewHeaders = CamillePmrVector<std::pair<std::string_view, std::string_view>>;
 
 /**
  * @brief String view iterator
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "camille/datastructures.h"
+
+namespace camille {
+namespace {
+
+using datastructure::LruCache;
+
+TEST(LruCache, GetAndPut) {
+  LruCache<std::string, int> cache{2};
+  EXPECT_FALSE(cache.get("a"));
+  cache.put("a", 1);
+  EXPECT_EQ(cache.get("a"), 1);
+  cache.put("a", 2);
+  EXPECT_EQ(cache.get("a"), 2);
+  EXPECT_EQ(cache.size(), 1U);
+}
+
+TEST(LruCache, EvictsTheLeastRecentlyUsed) {
+  LruCache<int, int> cache{2};
+  cache.put(1, 1);
+  cache.put(2, 2);
+  EXPECT_EQ(cache.get(1), 1);
+  cache.put(3, 3);
+  EXPECT_EQ(cache.get(1), 1);
+  EXPECT_FALSE(cache.get(2));
+  EXPECT_EQ(cache.get(3), 3);
+  EXPECT_EQ(cache.size(), 2U);
+}
+
+TEST(LruCache, PutRefreshesAnExistingKey) {
+  LruCache<int, int> cache{2};
+  cache.put(1, 1);
+  cache.put(2, 2);
+  cache.put(1, 10);
+  cache.put(3, 3);
+  EXPECT_EQ(cache.get(1), 10);
+  EXPECT_FALSE(cache.get(2));
+}
+
+TEST(LruCache, Erase) {
+  LruCache<int, int> cache{2};
+  cache.put(1, 1);
+  cache.erase(1);
+  cache.erase(2);
+  EXPECT_FALSE(cache.get(1));
+  EXPECT_EQ(cache.size(), 0U);
+  cache.put(2, 2);
+  cache.put(3, 3);
+  EXPECT_EQ(cache.size(), 2U);
+}
+
+TEST(LruCache, ZeroCapacityKeepsNothing) {
+  LruCache<int, int> cache{0};
+  cache.put(1, 1);
+  EXPECT_FALSE(cache.get(1));
+  EXPECT_EQ(cache.size(), 0U);
+}
+
+};  // namespace
+};  // namespace camille
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string_view>
+
+#include "camille/datastructures.h"
+#include "camille/router.h"
+
+namespace camille {
+namespace {
+
+using datastructure::PrefixTree;
+using infra::Methods;
+
+TEST(PrefixTree, StaticRoutesShareTheirPrefix) {
+  PrefixTree<int> tree;
+  tree.Insert(Methods::kGet, "/users", 1);
+  tree.Insert(Methods::kGet, "/users/me", 2);
+  tree.Insert(Methods::kGet, "/uploads", 3);
+  tree.Insert(Methods::kGet, "/", 4);
+  EXPECT_EQ(tree.Size(), 4U);
+
+  EXPECT_EQ(*tree.Find(Methods::kGet, "/users").value, 1);
+  EXPECT_EQ(*tree.Find(Methods::kGet, "/users/me").value, 2);
+  EXPECT_EQ(*tree.Find(Methods::kGet, "/uploads").value, 3);
+  EXPECT_EQ(*tree.Find(Methods::kGet, "/").value, 4);
+  EXPECT_EQ(tree.Find(Methods::kGet, "/use").value, nullptr);
+  EXPECT_EQ(tree.Find(Methods::kGet, "/users/").value, nullptr);
+}
+
+TEST(PrefixTree, Captures) {
+  PrefixTree<int> tree;
+  tree.Insert(Methods::kGet, "/users/{id}/posts/{post}", 1);
+  auto match = tree.Find(Methods::kGet, "/users/42/posts/7");
+  ASSERT_NE(match.value, nullptr);
+  EXPECT_EQ(match.params.size, 2U);
+  EXPECT_EQ(match.params.Get("id"), "42");
+  EXPECT_EQ(match.params.Get("post"), "7");
+  // a capture is one whole, non-empty segment.
+  EXPECT_EQ(tree.Find(Methods::kGet, "/users//posts/7").value, nullptr);
+  EXPECT_EQ(tree.Find(Methods::kGet, "/users/4/2/posts/7").value, nullptr);
+}
+
+TEST(PrefixTree, StaticBeatsCaptureBeatsWildcard) {
+  PrefixTree<int> tree;
+  tree.Insert(Methods::kGet, "/files/readme", 1);
+  tree.Insert(Methods::kGet, "/files/{name}", 2);
+  tree.Insert(Methods::kGet, "/files/*path", 3);
+
+  EXPECT_EQ(*tree.Find(Methods::kGet, "/files/readme").value, 1);
+  auto capture = tree.Find(Methods::kGet, "/files/license");
+  ASSERT_NE(capture.value, nullptr);
+  EXPECT_EQ(*capture.value, 2);
+  EXPECT_EQ(capture.params.Get("name"), "license");
+  auto wildcard = tree.Find(Methods::kGet, "/files/docs/a/b.txt");
+  ASSERT_NE(wildcard.value, nullptr);
+  EXPECT_EQ(*wildcard.value, 3);
+  EXPECT_EQ(wildcard.params.Get("path"), "docs/a/b.txt");
+}
+
+TEST(PrefixTree, BacktracksFromAStaticMiss) {
+  PrefixTree<int> tree;
+  // "/users/new" is static, "/users/newest/edit" has to come back to the capture.
+  tree.Insert(Methods::kGet, "/users/new", 1);
+  tree.Insert(Methods::kGet, "/users/{id}/edit", 2);
+  auto match = tree.Find(Methods::kGet, "/users/newest/edit");
+  ASSERT_NE(match.value, nullptr);
+  EXPECT_EQ(*match.value, 2);
+  EXPECT_EQ(match.params.Get("id"), "newest");
+  EXPECT_EQ(match.params.size, 1U);
+}
+
+TEST(PrefixTree, BacktracksFromACaptureToTheWildcard) {
+  PrefixTree<int> tree;
+  tree.Insert(Methods::kGet, "/api/{version}/status", 1);
+  tree.Insert(Methods::kGet, "/api/*rest", 2);
+  auto match = tree.Find(Methods::kGet, "/api/v1/other");
+  ASSERT_NE(match.value, nullptr);
+  EXPECT_EQ(*match.value, 2);
+  // the abandoned capture is not reported.
+  EXPECT_EQ(match.params.size, 1U);
+  EXPECT_EQ(match.params.Get("rest"), "v1/other");
+  EXPECT_FALSE(match.params.Get("version").has_value());
+}
+
+TEST(PrefixTree, MethodNotAllowedIsToldFromNotFound) {
+  PrefixTree<int> tree;
+  tree.Insert(Methods::kGet, "/items/{id}", 1);
+  tree.Insert(Methods::kPost, "/items", 2);
+  tree.Insert(Methods::kGet, "/static/*", 3);
+
+  auto wrong_method = tree.Find(Methods::kDelete, "/items/9");
+  EXPECT_EQ(wrong_method.value, nullptr);
+  EXPECT_TRUE(wrong_method.path_found);
+
+  auto wrong_wildcard_method = tree.Find(Methods::kPut, "/static/a.css");
+  EXPECT_EQ(wrong_wildcard_method.value, nullptr);
+  EXPECT_TRUE(wrong_wildcard_method.path_found);
+
+  auto unknown = tree.Find(Methods::kGet, "/nothing");
+  EXPECT_EQ(unknown.value, nullptr);
+  EXPECT_FALSE(unknown.path_found);
+
+  auto unknown_method = tree.Find(Methods::kUnknown, "/items");
+  EXPECT_EQ(unknown_method.value, nullptr);
+}
+
+TEST(PrefixTree, InvalidPatterns) {
+  PrefixTree<int> tree;
+  tree.Insert(Methods::kGet, "/a/{id}", 1);
+  EXPECT_THROW(tree.Insert(Methods::kGet, "no-slash", 1), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(Methods::kGet, "/a/{}", 1), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(Methods::kGet, "/a/{id", 1), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(Methods::kGet, "/a/x{id}", 1), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(Methods::kGet, "/a/*rest/more", 1), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(Methods::kGet, "/a/{other}", 1), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(Methods::kGet, "/a/{id}", 2), std::invalid_argument);
+  EXPECT_NO_THROW(tree.Insert(Methods::kPost, "/a/{id}", 2));
+}
+
+TEST(RouteTable, NotFoundAndMethodNotAllowed) {
+  router::Router router{"/v1", std::nullopt};
+  router.Get("/items/{id}", infra::StatusCodes::kOk, [](const request::RequestView&) {
+    return response::Response{};
+  });
+  router::RouteTable table;
+  table.Add(router);
+
+  request::RequestView found;
+  found.SetMethod("GET");
+  found.SetPath("/v1/items/5?verbose=1");
+  auto route = table.Find(found);
+  ASSERT_TRUE(route.has_value());
+  EXPECT_EQ(found.Param("id"), "5");
+
+  request::RequestView wrong_method;
+  wrong_method.SetMethod("POST");
+  wrong_method.SetPath("/v1/items/5");
+  EXPECT_EQ(table.Find(wrong_method).error(), infra::StatusCodes::kMethodNotAllowed);
+
+  request::RequestView missing;
+  missing.SetMethod("GET");
+  missing.SetPath("/v1/other");
+  EXPECT_EQ(table.Find(missing).error(), infra::StatusCodes::kNotFound);
+}
+
+};  // namespace
+};  // namespace camille
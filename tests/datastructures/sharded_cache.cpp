@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camille/datastructures.h"
+
+namespace camille {
+namespace {
+
+using datastructure::ShardedCache;
+using namespace std::chrono_literals;
+
+TEST(ShardedCache, GetPutErase) {
+  ShardedCache<std::string, int> cache{64, 4};
+  EXPECT_FALSE(cache.Get("a"));
+  cache.Put("a", 1);
+  cache.Put("b", 2);
+  EXPECT_EQ(cache.Get("a"), 1);
+  cache.Put("a", 3);
+  EXPECT_EQ(cache.Get("a"), 3);
+  EXPECT_EQ(cache.Size(), 2U);
+  EXPECT_TRUE(cache.Erase("a"));
+  EXPECT_FALSE(cache.Erase("a"));
+  EXPECT_FALSE(cache.Get("a"));
+  EXPECT_EQ(cache.Size(), 1U);
+
+  auto stats = cache.Stats();
+  EXPECT_EQ(stats.hits, 2U);
+  EXPECT_EQ(stats.misses, 2U);
+}
+
+TEST(ShardedCache, CapacityBelowShardCountThrows) {
+  // three shards round up to four.
+  EXPECT_THROW((ShardedCache<int, int>{3, 3}), std::invalid_argument);
+  EXPECT_NO_THROW((ShardedCache<int, int>{4, 3}));
+}
+
+TEST(ShardedCache, ClockGivesReferencedEntriesASecondChance) {
+  ShardedCache<int, int> cache{3, 1};
+  cache.Put(1, 1);
+  cache.Put(2, 2);
+  cache.Put(3, 3);
+  EXPECT_EQ(cache.Get(1), 1);
+
+  // the hand clears 1 and evicts 2, the first slot not referenced since the last pass.
+  cache.Put(4, 4);
+  EXPECT_EQ(cache.Get(1), 1);
+  EXPECT_FALSE(cache.Get(2));
+  EXPECT_EQ(cache.Get(3), 3);
+  EXPECT_EQ(cache.Get(4), 4);
+  EXPECT_EQ(cache.Size(), 3U);
+  EXPECT_EQ(cache.Stats().evictions, 1U);
+}
+
+TEST(ShardedCache, ClockEvictsWithinTwoTurnsWhenAllAreReferenced) {
+  ShardedCache<int, int> cache{3, 1};
+  for (int key{0}; key < 3; ++key) {
+    cache.Put(key, key);
+    EXPECT_EQ(cache.Get(key), key);
+  }
+  cache.Put(3, 3);
+  EXPECT_EQ(cache.Size(), 3U);
+  EXPECT_EQ(cache.Stats().evictions, 1U);
+  // the first turn cleared every bit and came back to slot 0.
+  EXPECT_FALSE(cache.Get(0));
+  EXPECT_EQ(cache.Get(3), 3);
+}
+
+TEST(ShardedCache, ExpiredEntriesMissAndAreReusedFirst) {
+  ShardedCache<int, int> cache{3, 1, 1h};
+  cache.Put(1, 1);
+  cache.Put(2, 2, 1ms);
+  cache.Put(3, 3);
+  EXPECT_EQ(cache.Get(1), 1);
+  std::this_thread::sleep_for(5ms);
+  EXPECT_FALSE(cache.Get(2));
+  EXPECT_EQ(cache.Get(3), 3);
+
+  // 1 and 3 are referenced, 2 is expired: the new entry takes its slot.
+  cache.Put(4, 4);
+  EXPECT_EQ(cache.Get(1), 1);
+  EXPECT_EQ(cache.Get(3), 3);
+  EXPECT_EQ(cache.Get(4), 4);
+  auto stats = cache.Stats();
+  EXPECT_EQ(stats.expirations, 1U);
+  EXPECT_EQ(stats.evictions, 0U);
+}
+
+TEST(ShardedCache, PutRefreshesTheTtl) {
+  ShardedCache<int, int> cache{4, 1, 1ms};
+  cache.Put(1, 1);
+  cache.Put(1, 2, 0ms);
+  std::this_thread::sleep_for(5ms);
+  EXPECT_EQ(cache.Get(1), 2);
+}
+
+TEST(ShardedCache, ConcurrentReadersAndWriters) {
+  ShardedCache<int, int> cache{256, 8};
+  std::vector<std::jthread> threads;
+  for (int thread{0}; thread < 4; ++thread) {
+    threads.emplace_back([&cache, thread] {
+      for (int round{0}; round < 20000; ++round) {
+        int key = (round * 7 + thread) % 512;
+        if (auto value = cache.Get(key)) {
+          EXPECT_EQ(*value, key);
+        } else {
+          cache.Put(key, key);
+        }
+      }
+    });
+  }
+  threads.clear();
+  EXPECT_LE(cache.Size(), 256U);
+}
+
+};  // namespace
+};  // namespace camille
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "camille/datastructures.h"
+
+namespace camille {
+namespace {
+
+using datastructure::WorkStealingDeque;
+
+TEST(WorkStealingDeque, OwnerPopsNewestThievesStealOldest) {
+  WorkStealingDeque<int> deque{2};
+  EXPECT_TRUE(deque.Empty());
+  for (int value{0}; value < 10; ++value) {
+    deque.Push(value);
+  }
+  EXPECT_EQ(deque.Steal(), 0);
+  EXPECT_EQ(deque.Pop(), 9);
+  EXPECT_EQ(deque.Steal(), 1);
+  EXPECT_EQ(deque.Pop(), 8);
+  for (int value{2}; value < 8; ++value) {
+    EXPECT_EQ(deque.Steal(), value);
+  }
+  EXPECT_FALSE(deque.Pop());
+  EXPECT_FALSE(deque.Steal());
+  EXPECT_TRUE(deque.Empty());
+}
+
+TEST(WorkStealingDeque, GrowingKeepsEveryItem) {
+  WorkStealingDeque<int> deque{2};
+  for (int value{0}; value < 1000; ++value) {
+    deque.Push(value);
+    if (value % 3 == 0) {
+      EXPECT_TRUE(deque.Steal());
+    }
+  }
+  int count{0};
+  while (deque.Pop()) {
+    ++count;
+  }
+  EXPECT_EQ(count, 1000 - 334);
+}
+
+TEST(WorkStealingDeque, LastItemGoesToExactlyOneSide) {
+  WorkStealingDeque<int> deque;
+  std::atomic<int> stolen{0};
+  std::atomic<bool> done{false};
+  constexpr int kRounds = 20000;
+
+  std::jthread thief([&] {
+    while (!done.load(std::memory_order_acquire)) {
+      if (deque.Steal()) {
+        stolen.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  });
+
+  int popped{0};
+  for (int index{0}; index < kRounds; ++index) {
+    deque.Push(index);
+    // give the thief a window on the single item, then race it.
+    for (int spin{0}; spin < index % 64; ++spin) {
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    if (deque.Pop()) {
+      ++popped;
+    }
+  }
+  done.store(true, std::memory_order_release);
+  thief.join();
+  EXPECT_EQ(popped + stolen.load(), kRounds);
+}
+
+TEST(WorkStealingDeque, ConcurrentThievesTakeEachItemOnce) {
+  constexpr int kItems = 100000;
+  WorkStealingDeque<int> deque{4};
+  std::vector<std::atomic<std::uint8_t>> taken(kItems);
+  std::atomic<bool> done{false};
+
+  auto take = [&taken](int value) { taken[value].fetch_add(1, std::memory_order_relaxed); };
+  std::vector<std::jthread> thieves;
+  for (int thief{0}; thief < 3; ++thief) {
+    thieves.emplace_back([&] {
+      while (!done.load(std::memory_order_acquire) || !deque.Empty()) {
+        if (auto value = deque.Steal()) {
+          take(*value);
+        }
+      }
+    });
+  }
+  for (int value{0}; value < kItems; ++value) {
+    deque.Push(value);
+    if (value % 2 == 0) {
+      if (auto popped = deque.Pop()) {
+        take(*popped);
+      }
+    }
+  }
+  while (auto popped = deque.Pop()) {
+    take(*popped);
+  }
+  done.store(true, std::memory_order_release);
+  thieves.clear();
+
+  for (int value{0}; value < kItems; ++value) {
+    ASSERT_EQ(taken[value].load(), 1) << value;
+  }
+}
+
+};  // namespace
+};  // namespace camille
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "camille/network.h"
+#include "camille/response.h"
+
+namespace camille {
+namespace {
+
+using response::Connection;
+
+std::string Written(response::Serializer& serializer) {
+  std::string wire;
+  for (const auto& buffer : serializer.Buffers()) {
+    wire.append(static_cast<const char*>(buffer.data()), buffer.size());
+  }
+  return wire;
+}
+
+TEST(NetworkPersistence, ParseErrorStatus) {
+  EXPECT_EQ(network::ParseErrorStatus(error::Errors::kHeaderLimit),
+            infra::StatusCodes::kRequestHeaderFieldsTooLarge);
+  EXPECT_EQ(network::ParseErrorStatus(error::Errors::kBadContentLength),
+            infra::StatusCodes::kBadRequest);
+  EXPECT_EQ(network::ParseErrorStatus(error::Errors::kSizeLimit),
+            infra::StatusCodes::kBadRequest);
+}
+
+TEST(NetworkPersistence, ConnectionFor) {
+  EXPECT_EQ(response::ConnectionFor(true, "1.1"), Connection::kPersistent);
+  EXPECT_EQ(response::ConnectionFor(false, "1.1"), Connection::kClose);
+  EXPECT_EQ(response::ConnectionFor(true, "1.0"), Connection::kKeepAlive);
+  EXPECT_EQ(response::ConnectionFor(false, "1.0"), Connection::kClose);
+}
+
+TEST(NetworkPersistence, ConnectionHeader) {
+  response::Serializer serializer;
+  serializer.Add(response::Response{infra::StatusCodes::kOk}, Connection::kPersistent);
+  serializer.Add(response::Response{infra::StatusCodes::kOk}, Connection::kKeepAlive);
+  serializer.Add(response::Response{infra::StatusCodes::kRequestHeaderFieldsTooLarge},
+                 Connection::kClose);
+  auto wire = Written(serializer);
+
+  auto second = wire.find("HTTP/1.1", 1);
+  auto third = wire.find("HTTP/1.1", second + 1);
+  ASSERT_NE(third, std::string::npos);
+  EXPECT_EQ(wire.substr(0, second).find("Connection:"), std::string::npos);
+  EXPECT_NE(wire.substr(second, third - second).find("Connection: keep-alive\r\n"),
+            std::string::npos);
+  EXPECT_TRUE(wire.substr(third).starts_with("HTTP/1.1 431 Request Header Fields Too Large\r\n"));
+  EXPECT_NE(wire.substr(third).find("Connection: close\r\n"), std::string::npos);
+}
+
+};  // namespace
+};  // namespace camille
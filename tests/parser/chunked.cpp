@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <expected>
+#include <string>
+#include <string_view>
+
+#include "camille/parser.h"
+#include "camille/request.h"
+
+namespace camille {
+namespace {
+
+using parser::Parser;
+using request::RequestView;
+
+constexpr std::string_view kHead =
+    "POST /upload HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n";
+
+std::string Chunked(std::string_view body, size_t chunk_size, std::string_view trailers = "") {
+  std::string message{kHead};
+  for (size_t offset{0}; offset < body.size(); offset += chunk_size) {
+    auto chunk = body.substr(offset, chunk_size);
+    char size[17];
+    std::snprintf(size, sizeof(size), "%zx", chunk.size());
+    message.append(size).append("\r\n").append(chunk).append("\r\n");
+  }
+  return message.append("0\r\n").append(trailers).append("\r\n");
+}
+
+std::string Body(size_t size) {
+  std::string body;
+  for (size_t index{0}; index < size; ++index) {
+    body += static_cast<char>('a' + index % 26);
+  }
+  return body;
+}
+
+/**
+ * @brief Delivers message step bytes at a time into a buffer the way the session does: the whole
+ * unconsumed buffer is fed and what the parser releases is dropped from its front.
+ */
+struct Session {
+  Parser parser;
+  std::string buffer;
+  size_t peak{0};
+
+  std::expected<RequestView, error::Errors> Run(std::string_view message, size_t step) {
+    std::expected<RequestView, error::Errors> result =
+        std::unexpected(error::Errors::kPartialMessage);
+    for (size_t offset{0}; offset < message.size(); offset += step) {
+      buffer.append(message.substr(offset, step));
+      peak = std::max(peak, buffer.size());
+      result = parser.Feed<RequestView>(buffer);
+      if (result || result.error() != error::Errors::kPartialMessage) {
+        return result;
+      }
+      buffer.erase(0, parser.Release());
+    }
+    return result;
+  }
+};
+
+TEST(ParserChunked, SingleChunkIsAView) {
+  std::string message = Chunked("hello", 5);
+  Parser parser;
+  auto request = parser.Feed<RequestView>(message);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->Body(), "hello");
+  EXPECT_EQ(parser.Consumed(), message.size());
+}
+
+TEST(ParserChunked, ChunksAreJoined) {
+  auto body = Body(1000);
+  for (size_t step : {size_t{1}, size_t{7}, size_t{4096}}) {
+    Session session;
+    auto request = session.Run(Chunked(body, 64), step);
+    ASSERT_TRUE(request.has_value()) << "step " << step;
+    EXPECT_EQ(request->Body(), body) << "step " << step;
+  }
+}
+
+TEST(ParserChunked, ExtensionsAreSkipped) {
+  std::string message{kHead};
+  message += "5;name=value;quoted=\"a;b\\\"c\"\r\nhello\r\n0;last\r\n\r\n";
+  Session session;
+  auto request = session.Run(message, 1);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->Body(), "hello");
+}
+
+TEST(ParserChunked, Trailers) {
+  Session session;
+  auto request = session.Run(Chunked("hello", 2, "X-Checksum: abc\r\nHost: evil\r\n"), 1);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->Body(), "hello");
+  ASSERT_EQ(request->Trailers().size(), 2U);
+  EXPECT_EQ(request->Trailers()[0].first, "X-Checksum");
+  EXPECT_EQ(request->Trailers()[0].second, "abc");
+  // a trailer never overrides the headers.
+  EXPECT_EQ(request->Host(), "example.com");
+  EXPECT_EQ(request->GetHeader("Host"), "example.com");
+}
+
+TEST(ParserChunked, SinkReceivesEveryChunk) {
+  auto body = Body(20 * 1024);
+  Session session;
+  std::string received;
+  size_t calls{0};
+  session.parser.SetBodySink([&](std::string_view data) {
+    received += data;
+    ++calls;
+  });
+  auto request = session.Run(Chunked(body, 1024, "X-Sum: 1\r\n"), 100);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_TRUE(request->Body().empty());
+  EXPECT_EQ(received, body);
+  EXPECT_GE(calls, 20U);
+  EXPECT_EQ(request->Trailers().size(), 1U);
+  // the decoded chunks were released, the buffer never held the whole body.
+  EXPECT_LT(session.peak, 2048U);
+}
+
+TEST(ParserChunked, HeadHookPicksTheSinkPerMessage) {
+  std::string uploaded;
+  std::string path;
+  Session session;
+  session.parser.SetHeadHook([&](const Parser& parser) -> Parser::BodySink {
+    auto head = parser.Head<RequestView>();
+    path = head.Path();
+    if (head.Path() != "/upload") {
+      return nullptr;
+    }
+    return [&](std::string_view data) { uploaded += data; };
+  });
+  auto request = session.Run(Chunked("streamed", 3), 5);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(path, "/upload");
+  EXPECT_EQ(uploaded, "streamed");
+  EXPECT_TRUE(request->Body().empty());
+}
+
+TEST(ParserChunked, ReleasedBufferKeepsThePipeline) {
+  std::string next = "GET /next HTTP/1.1\r\nHost: example.com\r\n\r\n";
+  Session session;
+  auto request = session.Run(Chunked(Body(300), 10) + next, 13);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->Body(), Body(300));
+  auto rest = std::string_view(session.buffer).substr(session.parser.Consumed());
+
+  session.parser.Reset();
+  ASSERT_TRUE(next.starts_with(rest));
+  auto second = session.parser.Feed<RequestView>(next);
+  ASSERT_TRUE(second.has_value());
+  EXPECT_EQ(second->Path(), "/next");
+}
+
+TEST(ParserChunked, Malformed) {
+  const std::string_view bodies[] = {
+      "z\r\nhello\r\n0\r\n\r\n",        // not a hex size
+      "5\r\nhelloX\r\n0\r\n\r\n",       // data longer than its size
+      "5;=v\r\nhello\r\n0\r\n\r\n",     // extension without a name
+  };
+  for (auto body : bodies) {
+    std::string message{kHead};
+    message += body;
+    Session session;
+    auto request = session.Run(message, 1);
+    ASSERT_FALSE(request.has_value()) << body;
+    EXPECT_EQ(request.error(), error::Errors::kBadBody) << body;
+  }
+}
+
+TEST(ParserChunked, OnlyExactlyChunkedIsAccepted) {
+  Parser parser;
+  auto request = parser.Feed<RequestView>(
+      "POST / HTTP/1.1\r\nHost: a\r\nTransfer-Encoding: gzip, chunked\r\n\r\n");
+  ASSERT_FALSE(request.has_value());
+  EXPECT_EQ(request.error(), error::Errors::kBadRequest);
+}
+
+TEST(ParserChunked, Limits) {
+  Session chunk;
+  chunk.parser = Parser{parser::ParserLimits{.max_chunk_size = 16}};
+  auto too_big = chunk.Run(Chunked(Body(17), 17), 1);
+  ASSERT_FALSE(too_big.has_value());
+  EXPECT_EQ(too_big.error(), error::Errors::kBodyLimit);
+
+  Session total;
+  total.parser = Parser{parser::ParserLimits{.max_body_size = 100}};
+  auto too_long = total.Run(Chunked(Body(101), 10), 3);
+  ASSERT_FALSE(too_long.has_value());
+  EXPECT_EQ(too_long.error(), error::Errors::kBodyLimit);
+
+  Session fits;
+  fits.parser = Parser{parser::ParserLimits{.max_body_size = 100}};
+  EXPECT_TRUE(fits.Run(Chunked(Body(100), 10), 3));
+}
+
+TEST(ParserChunked, TrailerCaps) {
+  std::string trailers;
+  for (size_t index{0}; index < parser::kHeaderCountLimit + 1; ++index) {
+    trailers += "X-" + std::to_string(index) + ": v\r\n";
+  }
+  Session session;
+  auto request = session.Run(Chunked("hello", 5, trailers), 64);
+  ASSERT_FALSE(request.has_value());
+  EXPECT_EQ(request.error(), error::Errors::kHeaderLimit);
+}
+
+};  // namespace
+};  // namespace camille
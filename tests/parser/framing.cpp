@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <expected>
+#include <string>
+#include <string_view>
+
+#include "camille/parser.h"
+#include "camille/request.h"
+
+namespace camille {
+namespace {
+
+using parser::Parser;
+using request::RequestView;
+
+std::expected<RequestView, error::Errors> Parse(Parser& parser, std::string_view message) {
+  return parser.Feed<RequestView>(message);
+}
+
+void ExpectRejected(std::string_view message, error::Errors expected) {
+  Parser parser;
+  auto request = Parse(parser, message);
+  ASSERT_FALSE(request.has_value()) << message;
+  EXPECT_EQ(request.error(), expected) << message;
+}
+
+TEST(ParserFraming, RepeatedContentLength) {
+  ExpectRejected(
+      "POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhello",
+      error::Errors::kBadContentLength);
+  // the repeat is caught whatever the case of the name.
+  ExpectRejected(
+      "POST / HTTP/1.1\r\nHost: a\r\ncontent-length: 0\r\nCONTENT-LENGTH: 5\r\n\r\nhello",
+      error::Errors::kBadContentLength);
+}
+
+TEST(ParserFraming, RepeatedTransferEncoding) {
+  ExpectRejected(
+      "POST / HTTP/1.1\r\nHost: a\r\nTransfer-Encoding: chunked\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n0\r\n\r\n",
+      error::Errors::kBadRequest);
+}
+
+TEST(ParserFraming, ContentLengthWithTransferEncoding) {
+  ExpectRejected(
+      "POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "0\r\n\r\n",
+      error::Errors::kBadRequest);
+}
+
+TEST(ParserFraming, HostExactlyOnce) {
+  ExpectRejected("GET / HTTP/1.1\r\nAccept: */*\r\n\r\n", error::Errors::kBadRequest);
+  ExpectRejected("GET / HTTP/1.1\r\nHost: a\r\nHost: b\r\n\r\n", error::Errors::kBadRequest);
+}
+
+TEST(ParserFraming, LowercaseNames) {
+  std::string pipeline =
+      "POST / HTTP/1.1\r\nhost: a\r\ncontent-length: 5\r\n\r\nhello"
+      "GET /next HTTP/1.1\r\nhost: a\r\n\r\n";
+  Parser parser;
+  auto request = Parse(parser, pipeline);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->Body(), "hello");
+  auto consumed = parser.Consumed();
+
+  parser.Reset();
+  auto next = Parse(parser, std::string_view(pipeline).substr(consumed));
+  ASSERT_TRUE(next.has_value());
+  EXPECT_EQ(next->Path(), "/next");
+}
+
+TEST(ParserFraming, RepeatedHeaderReadsAsFirstValue) {
+  Parser parser;
+  auto request = Parse(parser, "GET / HTTP/1.1\r\nHost: a\r\nAccept: a\r\nAccept: b\r\n\r\n");
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->GetHeader(infra::HeaderId::kAccept), "a");
+  EXPECT_EQ(request->GetHeader("accept"), "a");
+  EXPECT_EQ(request->HeaderCount(infra::HeaderId::kAccept), 2);
+}
+
+bool KeepAlive(std::string_view message) {
+  Parser parser;
+  auto request = Parse(parser, message);
+  EXPECT_TRUE(request.has_value()) << message;
+  return request.has_value() && request->KeepAlive();
+}
+
+TEST(RequestKeepAlive, Http11StaysOpenUnlessClose) {
+  EXPECT_TRUE(KeepAlive("GET / HTTP/1.1\r\nHost: a\r\n\r\n"));
+  EXPECT_FALSE(KeepAlive("GET / HTTP/1.1\r\nHost: a\r\nConnection: close\r\n\r\n"));
+  EXPECT_FALSE(KeepAlive("GET / HTTP/1.1\r\nHost: a\r\nconnection: Upgrade, CLOSE\r\n\r\n"));
+}
+
+TEST(RequestKeepAlive, Http10ClosesUnlessKeepAlive) {
+  EXPECT_FALSE(KeepAlive("GET / HTTP/1.0\r\nHost: a\r\n\r\n"));
+  EXPECT_TRUE(KeepAlive("GET / HTTP/1.0\r\nHost: a\r\nConnection: keep-alive\r\n\r\n"));
+}
+
+TEST(RequestKeepAlive, RepeatedConnectionHeadersAreOneList) {
+  EXPECT_FALSE(KeepAlive(
+      "GET / HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\nConnection: close\r\n\r\n"));
+  EXPECT_TRUE(KeepAlive(
+      "GET / HTTP/1.0\r\nHost: a\r\nConnection: Upgrade\r\nConnection: keep-alive\r\n\r\n"));
+}
+
+};  // namespace
+};  // namespace camille
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+
+#include <expected>
+#include <string>
+#include <string_view>
+
+#include "camille/parser.h"
+#include "camille/request.h"
+
+namespace camille {
+namespace {
+
+using parser::Parser;
+using request::RequestView;
+
+constexpr std::string_view kGet =
+    "GET /users/42?fields=name HTTP/1.1\r\n"
+    "Host: example.com:8080\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+
+constexpr std::string_view kPost =
+    "POST /submit HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "Content-Length: 11\r\n"
+    "\r\n"
+    "hello world";
+
+/**
+ * @brief Feeds message one byte more per call, the way a slow client delivers it, until it
+ * completes or fails.
+ */
+std::expected<RequestView, error::Errors> FeedBytewise(Parser& parser, std::string_view message) {
+  std::expected<RequestView, error::Errors> result =
+      std::unexpected(error::Errors::kPartialMessage);
+  for (size_t size{1}; size <= message.size(); ++size) {
+    result = parser.Feed<RequestView>(message.substr(0, size));
+    if (result) {
+      EXPECT_EQ(size, message.size()) << "completed before the last byte";
+      return result;
+    }
+    if (result.error() != error::Errors::kPartialMessage) {
+      return result;
+    }
+  }
+  return result;
+}
+
+std::string HeaderBlock(size_t fields, size_t value_size) {
+  std::string message = "GET / HTTP/1.1\r\nHost: a\r\n";
+  for (size_t index{0}; index < fields; ++index) {
+    message += "X-" + std::to_string(index) + ": " + std::string(value_size, 'v') + "\r\n";
+  }
+  return message + "\r\n";
+}
+
+TEST(ParserResumable, WholeMessage) {
+  Parser parser;
+  auto request = parser.Feed<RequestView>(kGet);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->Method(), "GET");
+  EXPECT_EQ(request->Path(), "/users/42?fields=name");
+  EXPECT_EQ(request->Version(), "1.1");
+  EXPECT_EQ(request->Host(), "example.com");
+  EXPECT_EQ(request->Port(), "8080");
+  EXPECT_EQ(request->GetHeader("accept"), "*/*");
+  EXPECT_EQ(parser.Consumed(), kGet.size());
+}
+
+TEST(ParserResumable, ByteAtATimeHeaders) {
+  Parser parser;
+  auto request = FeedBytewise(parser, kGet);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->Path(), "/users/42?fields=name");
+  EXPECT_EQ(request->Host(), "example.com");
+  EXPECT_EQ(parser.Consumed(), kGet.size());
+}
+
+TEST(ParserResumable, ByteAtATimeBody) {
+  Parser parser;
+  auto request = FeedBytewise(parser, kPost);
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->ContentLength(), 11U);
+  EXPECT_EQ(request->Body(), "hello world");
+}
+
+TEST(ParserResumable, EverySplitPoint) {
+  for (size_t split{1}; split < kPost.size(); ++split) {
+    Parser parser;
+    auto first = parser.Feed<RequestView>(kPost.substr(0, split));
+    ASSERT_FALSE(first.has_value()) << "split " << split;
+    ASSERT_EQ(first.error(), error::Errors::kPartialMessage) << "split " << split;
+    // the bytes may have moved in between, as in a growing asio::streambuf.
+    std::string moved{kPost};
+    auto second = parser.Feed<RequestView>(moved);
+    ASSERT_TRUE(second.has_value()) << "split " << split;
+    EXPECT_EQ(second->Body(), "hello world");
+    EXPECT_EQ(second->Host(), "example.com");
+  }
+}
+
+TEST(ParserResumable, PipelinedMessagesAfterReset) {
+  std::string pipeline{kGet};
+  pipeline += kPost;
+  Parser parser;
+  auto first = parser.Feed<RequestView>(pipeline);
+  ASSERT_TRUE(first.has_value());
+  EXPECT_EQ(first->Method(), "GET");
+  auto consumed = parser.Consumed();
+  EXPECT_EQ(consumed, kGet.size());
+
+  parser.Reset();
+  auto second = parser.Feed<RequestView>(std::string_view(pipeline).substr(consumed));
+  ASSERT_TRUE(second.has_value());
+  EXPECT_EQ(second->Method(), "POST");
+  EXPECT_EQ(second->Body(), "hello world");
+}
+
+TEST(ParserResumable, StaleWithoutReset) {
+  Parser parser;
+  ASSERT_TRUE(parser.Feed<RequestView>(kGet).has_value());
+  auto again = parser.Feed<RequestView>(kGet);
+  ASSERT_FALSE(again.has_value());
+  EXPECT_EQ(again.error(), error::Errors::kStaleParser);
+}
+
+TEST(ParserResumable, InBodyOnlyAfterTheHeaderBlock) {
+  Parser parser;
+  auto head_size = kPost.find("\r\n\r\n") + 4;
+  ASSERT_FALSE(parser.Feed<RequestView>(kPost.substr(0, head_size - 1)).has_value());
+  EXPECT_FALSE(parser.InBody());
+  ASSERT_FALSE(parser.Feed<RequestView>(kPost.substr(0, head_size + 2)).has_value());
+  EXPECT_TRUE(parser.InBody());
+}
+
+TEST(ParserMalformed, Rejected) {
+  struct Case {
+    std::string_view message;
+    error::Errors error;
+  };
+  const Case cases[] = {
+      {"GE T / HTTP/1.1\r\nHost: a\r\n\r\n", error::Errors::kBadMethod},
+      {"GET / HTPP/1.1\r\nHost: a\r\n\r\n", error::Errors::kBadVersion},
+      {"GET / HTTP/1.1\r\nHost: a\r\nBad Key: v\r\n\r\n", error::Errors::kBadRequest},
+      {"GET / HTTP/1.1\r\n\r\n", error::Errors::kBadRequest},
+      {"POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 1x\r\n\r\n",
+       error::Errors::kBadContentLength},
+  };
+  for (const auto& [message, expected] : cases) {
+    Parser whole;
+    auto request = whole.Feed<RequestView>(message);
+    ASSERT_FALSE(request.has_value()) << message;
+    EXPECT_NE(request.error(), error::Errors::kPartialMessage) << message;
+
+    Parser bytewise;
+    auto split = FeedBytewise(bytewise, message);
+    ASSERT_FALSE(split.has_value()) << message;
+    EXPECT_EQ(split.error(), request.error()) << message;
+    EXPECT_EQ(request.error(), expected) << message;
+  }
+}
+
+TEST(ParserMalformed, LineLongerThanTheLimit) {
+  std::string message = "GET /" + std::string(parser::kLineLimit, 'a');
+  Parser parser;
+  auto request = parser.Feed<RequestView>(message);
+  ASSERT_FALSE(request.has_value());
+  EXPECT_EQ(request.error(), error::Errors::kSizeLimit);
+}
+
+TEST(ParserHeaderLimits, FieldCount) {
+  Parser parser;
+  auto request = parser.Feed<RequestView>(HeaderBlock(parser::kHeaderCountLimit + 1, 1));
+  ASSERT_FALSE(request.has_value());
+  EXPECT_EQ(request.error(), error::Errors::kHeaderLimit);
+
+  Parser at_limit;
+  // Host is one of the counted fields.
+  EXPECT_TRUE(at_limit.Feed<RequestView>(HeaderBlock(parser::kHeaderCountLimit - 1, 1)));
+}
+
+TEST(ParserHeaderLimits, BlockBytes) {
+  // every line is under kLineLimit, the block as a whole is not.
+  auto message = HeaderBlock(10, 4000);
+  ASSERT_GT(message.size(), parser::kHeaderBytesLimit);
+  Parser parser;
+  auto request = parser.Feed<RequestView>(message);
+  ASSERT_FALSE(request.has_value());
+  EXPECT_EQ(request.error(), error::Errors::kHeaderLimit);
+}
+
+TEST(ParserHeaderLimits, IncompleteBlockFailsEarly) {
+  // no final CRLF yet, the cap holds before the block ends.
+  auto message = HeaderBlock(10, 4000);
+  message.resize(message.size() - 2);
+  Parser parser;
+  auto request = parser.Feed<RequestView>(message);
+  ASSERT_FALSE(request.has_value());
+  EXPECT_EQ(request.error(), error::Errors::kHeaderLimit);
+}
+
+TEST(ParserHeaderLimits, Configurable) {
+  Parser parser{parser::ParserLimits{.max_header_count = 4}};
+  auto request = parser.Feed<RequestView>(HeaderBlock(4, 1));
+  ASSERT_FALSE(request.has_value());
+  EXPECT_EQ(request.error(), error::Errors::kHeaderLimit);
+
+  Parser larger{parser::ParserLimits{.max_header_bytes = 64 * 1024}};
+  EXPECT_TRUE(larger.Feed<RequestView>(HeaderBlock(10, 4000)));
+}
+
+};  // namespace
+};  // namespace camille
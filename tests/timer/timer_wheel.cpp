@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "asio/io_context.hpp"
+
+#include "camille/timer.h"
+
+namespace camille {
+namespace {
+
+using timer::kTick;
+using timer::TimerNode;
+using timer::TimerWheel;
+
+/**
+ * @brief Records the tick it fired on.
+ */
+struct Probe {
+  explicit Probe(TimerWheel& wheel)
+      : wheel(wheel),
+        node(&Probe::OnFire, this) {}
+
+  static void OnFire(void* owner) {
+    auto* probe = static_cast<Probe*>(owner);
+    probe->fired.push_back(probe->wheel.Now());
+  }
+
+  TimerWheel& wheel;
+  TimerNode node;
+  std::vector<std::uint64_t> fired;
+};
+
+class TimerWheelTest : public ::testing::Test {
+ protected:
+  void AdvanceTo(std::uint64_t tick) {
+    while (wheel_.Now() < tick) {
+      wheel_.Advance();
+    }
+  }
+
+  asio::io_context io_context_;
+  TimerWheel& wheel_{asio::use_service<TimerWheel>(io_context_)};
+};
+
+TEST_F(TimerWheelTest, FiresOnItsTick) {
+  Probe probe{wheel_};
+  wheel_.Schedule(probe.node, 5 * kTick);
+  EXPECT_TRUE(probe.node.Armed());
+  EXPECT_EQ(wheel_.Size(), 1U);
+  AdvanceTo(4);
+  EXPECT_TRUE(probe.fired.empty());
+  AdvanceTo(5);
+  ASSERT_EQ(probe.fired.size(), 1U);
+  EXPECT_EQ(probe.fired[0], 5U);
+  EXPECT_FALSE(probe.node.Armed());
+  EXPECT_EQ(wheel_.Size(), 0U);
+}
+
+TEST_F(TimerWheelTest, RoundsUpToTheNextTick) {
+  Probe zero{wheel_};
+  Probe partial{wheel_};
+  wheel_.Schedule(zero.node, kTick * 0);
+  wheel_.Schedule(partial.node, kTick + kTick / 2);
+  AdvanceTo(2);
+  EXPECT_EQ(zero.fired, std::vector<std::uint64_t>{1});
+  EXPECT_EQ(partial.fired, std::vector<std::uint64_t>{2});
+}
+
+TEST_F(TimerWheelTest, CascadesAcrossEveryLevel) {
+  // one delay per level and around the level boundaries, from a start that is not slot aligned.
+  const std::uint64_t delays[] = {1,        63,        64,        65,         100,
+                                  4095,     4096,      4097,      5000,       262143,
+                                  262144,   262145,    300001,    1000000};
+  AdvanceTo(37);
+  std::vector<std::unique_ptr<Probe>> probes;
+  for (auto delay : delays) {
+    probes.push_back(std::make_unique<Probe>(wheel_));
+    wheel_.Schedule(probes.back()->node, delay * kTick);
+  }
+  EXPECT_EQ(wheel_.Size(), probes.size());
+
+  AdvanceTo(37 + 1000000);
+  for (size_t index{0}; index < probes.size(); ++index) {
+    ASSERT_EQ(probes[index]->fired.size(), 1U) << "delay " << delays[index];
+    EXPECT_EQ(probes[index]->fired[0], 37 + delays[index]) << "delay " << delays[index];
+  }
+  EXPECT_EQ(wheel_.Size(), 0U);
+}
+
+TEST_F(TimerWheelTest, CancelAndReschedule) {
+  Probe cancelled{wheel_};
+  Probe moved{wheel_};
+  wheel_.Schedule(cancelled.node, 100 * kTick);
+  wheel_.Schedule(moved.node, 100 * kTick);
+  AdvanceTo(50);
+  cancelled.node.Cancel();
+  // rescheduling replaces the previous deadline.
+  wheel_.Schedule(moved.node, 10 * kTick);
+  EXPECT_EQ(wheel_.Size(), 1U);
+  AdvanceTo(200);
+  EXPECT_TRUE(cancelled.fired.empty());
+  EXPECT_EQ(moved.fired, std::vector<std::uint64_t>{60});
+}
+
+TEST_F(TimerWheelTest, DestroyedNodeLeavesTheWheel) {
+  {
+    Probe probe{wheel_};
+    wheel_.Schedule(probe.node, 10 * kTick);
+    EXPECT_EQ(wheel_.Size(), 1U);
+  }
+  EXPECT_EQ(wheel_.Size(), 0U);
+  AdvanceTo(20);
+}
+
+TEST_F(TimerWheelTest, CallbackCanRescheduleItself) {
+  struct Periodic {
+    explicit Periodic(TimerWheel& wheel)
+        : wheel(wheel),
+          node(&Periodic::OnFire, this) {}
+    static void OnFire(void* owner) {
+      auto* periodic = static_cast<Periodic*>(owner);
+      if (++periodic->count < 3) {
+        periodic->wheel.Schedule(periodic->node, 70 * kTick);
+      }
+    }
+    TimerWheel& wheel;
+    TimerNode node;
+    int count{0};
+  };
+  Periodic periodic{wheel_};
+  wheel_.Schedule(periodic.node, 70 * kTick);
+  AdvanceTo(209);
+  EXPECT_EQ(periodic.count, 2);
+  AdvanceTo(210);
+  EXPECT_EQ(periodic.count, 3);
+  EXPECT_FALSE(periodic.node.Armed());
+}
+
+TEST_F(TimerWheelTest, LongTimeoutsAreClamped) {
+  Probe probe{wheel_};
+  wheel_.Schedule(probe.node, std::chrono::hours(24 * 365));
+  EXPECT_TRUE(probe.node.Armed());
+  probe.node.Cancel();
+  EXPECT_EQ(wheel_.Size(), 0U);
+}
+
+};  // namespace
+};  // namespace camille